@@ -1,6 +1,10 @@
 #ifndef COSC4315HW2_SRC_MYPYTHON_AST_HPP_
 #define COSC4315HW2_SRC_MYPYTHON_AST_HPP_
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -11,30 +15,66 @@
 
 namespace MyPython {
 struct Assign;
+struct Attribute;
+struct AugAssign;
+struct BigInt;
 struct BoolOp;
 struct BinOp;
+struct Call;
+struct Code;
 struct Compare;
+struct Dict;
 struct Expr;
+struct For;
 struct FunctionDef;
+struct Generator;
 struct If;
+struct List;
+struct ListComp;
 struct Module;
 struct Name;
 struct NameConstant;
 struct Num;
 struct Print;
+struct PyBuiltin;
+class PyDict;
+struct PyFloat;
 struct PyFunction;
+struct PyGenerator;
 struct PyInt;
+struct PyList;
 struct PyBool;
 struct PyNoneType;
+struct PyRange;
 struct PyStr;
+class PyTuple;
 struct Return;
+struct Scope;
+struct Stack;
 struct Str;
+struct Subscript;
+struct Tuple;
+struct While;
+struct Yield;
 
 using Expression =
-    mpark::variant<BoolOp, BinOp, Compare, Num, Str, NameConstant, Name>;
-using Statement = mpark::variant<FunctionDef, Return, Assign, If, Expr, Print>;
-using PyObj = mpark::variant<PyNoneType, PyBool, PyInt, PyStr, PyFunction>;
+    mpark::variant<BoolOp, BinOp, Call, Compare, Num, Str, NameConstant, Name,
+                   Yield, Attribute, List, ListComp, Subscript, Dict, Tuple>;
+using Statement = mpark::variant<FunctionDef, Return, Assign, AugAssign, If,
+                                 Expr, Print, While, For>;
+using PyObj = mpark::variant<PyNoneType, PyBool, PyInt, PyFloat, PyStr,
+                             PyFunction, PyBuiltin, PyGenerator, PyRange,
+                             PyList, PyDict, PyTuple>;
 using BindingMap = std::map<std::string, std::shared_ptr<PyObj>>;
+using BuiltinFn = std::shared_ptr<PyObj> (*)(
+    std::vector<std::shared_ptr<PyObj>> const& args, Stack& stack);
+
+// A variable shared between a function and the closures that capture it.
+struct Cell {
+  std::shared_ptr<PyObj> value = nullptr;
+};
+
+using CellMap = std::map<std::string, std::shared_ptr<Cell>>;
 
 enum class BoolOperator { and_op, or_op };
 enum class CmpOp { eq, eq_not, lt, lt_eq, gt, gt_eq, is, is_not, in, not_in };
@@ -71,6 +111,21 @@ struct Assign {
   Metadata meta = {};
 };
 
+// Only called, as in x.append(y).
+struct Attribute {
+  std::shared_ptr<Expression> value = nullptr;
+  std::string attr = "";
+  Metadata meta = {};
+};
+
+// target op= value, where target is a name or a subscript.
+struct AugAssign {
+  std::shared_ptr<Expression> target = nullptr;
+  Op op = Op::add;
+  std::shared_ptr<Expression> value = nullptr;
+  Metadata meta = {};
+};
+
 struct BoolOp {
   std::shared_ptr<Expression> left = nullptr;
   BoolOperator op = BoolOperator::and_op;
@@ -84,6 +139,12 @@ struct BinOp {
   Metadata meta = {};
 };
 
+struct Call {
+  std::shared_ptr<Expression> func = nullptr;
+  std::vector<Expression> args = {};
+  Metadata meta = {};
+};
+
 struct Compare {
   std::shared_ptr<Expression> left = nullptr;
   std::vector<CmpOp> ops = {};
@@ -91,11 +152,26 @@ struct Compare {
   Metadata meta = {};
 };
 
+struct Dict {
+  std::vector<Expression> keys = {};
+  std::vector<Expression> values = {};
+  Metadata meta = {};
+};
+
 struct Expr {
   std::shared_ptr<Expression> value = nullptr;
   Metadata meta = {};
 };
 
+struct For {
+  std::shared_ptr<Expression> target = nullptr;
+  std::shared_ptr<Expression> iter = nullptr;
+  std::vector<Statement> body = {};
+  // Runs once the iterable is exhausted.
+  std::vector<Statement> or_else = {};
+  Metadata meta = {};
+};
+
 struct FunctionDef {
   std::string name = "";
   std::vector<std::string> args = {};
@@ -109,6 +185,21 @@ struct If {
   Metadata meta = {};
 };
 
+struct List {
+  std::vector<Expression> elts = {};
+  Metadata meta = {};
+};
+
+// [elt for target in iter if ifs...], with a single for clause. As in Python
+// 2, the target is bound in the enclosing scope.
+struct ListComp {
+  std::shared_ptr<Expression> elt = nullptr;
+  std::shared_ptr<Expression> target = nullptr;
+  std::shared_ptr<Expression> iter = nullptr;
+  std::vector<Expression> ifs = {};
+  Metadata meta = {};
+};
+
 struct Module {
   std::vector<Statement> body = {};
   Metadata meta = {};
@@ -133,8 +224,11 @@ struct Print {
   std::ostream* file = &std::cout;
 };
 
+// An integer of any size. Values that fit in a long are held inline in value;
+// larger ones are held in big, which is null otherwise.
 struct PyInt {
   long value = 0;
+  std::shared_ptr<BigInt const> big = nullptr;
 
   PyInt() = default;
   PyInt(long value) : value(value) {}
@@ -142,18 +236,237 @@ struct PyInt {
 
 struct PyBool : public PyInt {};
 
+struct PyFloat {
+  double value = 0;
+
+  PyFloat() = default;
+  // Explicit, so that plain ints and bools still convert to PyInt.
+  explicit PyFloat(double value) : value(value) {}
+};
+
 struct PyNoneType {};
 
-struct PyStr {
-  std::string value = "";
+// An immutable string of UTF-8 bytes, measured, indexed and iterated by code
+// point. Strings of up to inline_capacity bytes are held inline; longer ones
+// live in a reference-counted buffer that copies share. The hash is computed
+// at most once per copy, the code points of a buffer are counted at most once,
+// and whether every byte is ASCII is recorded when the string is built.
+class PyStr {
+ public:
+  static constexpr std::size_t inline_capacity = 23;
+
+  // The copy of value held by the process-wide intern table, added on first
+  // use. Interned strings always live in a buffer, so two of them are equal
+  // exactly when they share it. They are never freed.
+  static auto intern(std::string const& value) -> PyStr;
 
   PyStr() = default;
-  PyStr(std::string const& value) : value(value) {}
-  PyStr(char const* cstr) : PyStr(std::string(cstr)) {}
+  PyStr(char const* data, std::size_t size);
+  PyStr(std::string const& value) : PyStr(value.data(), value.size()) {}
+  PyStr(char const* cstr) : PyStr(cstr, std::strlen(cstr)) {}
+  PyStr(PyStr const& other);
+  PyStr(PyStr&& other) noexcept;
+  auto operator=(PyStr const& other) -> PyStr&;
+  auto operator=(PyStr&& other) noexcept -> PyStr&;
+  ~PyStr();
+
+  auto data() const -> char const* {
+    return heap() ? reinterpret_cast<char const*>(buffer() + 1) : small_;
+  }
+  auto size() const -> std::size_t {
+    return heap() ? buffer()->size : meta_ & size_mask;
+  }
+  auto empty() const -> bool { return size() == 0; }
+  auto ascii() const -> bool { return (meta_ & ascii_flag) != 0; }
+  auto interned() const -> bool { return (meta_ & interned_flag) != 0; }
+  auto hash() const -> std::size_t;
+  auto string() const -> std::string { return std::string(data(), size()); }
+
+  // The number of code points.
+  auto length() const -> std::size_t;
+  // The byte offset of the code point after the one at byte offset pos.
+  auto next(std::size_t pos) const -> std::size_t;
+  // The byte offset of code point index, which must be less than length().
+  auto offset(std::size_t index) const -> std::size_t;
+
+  // Whether both share one buffer, which makes them equal.
+  auto same_buffer(PyStr const& other) const -> bool {
+    return heap() && other.heap() && buffer() == other.buffer();
+  }
+
+  // The string repeated count times, filled by doubling copies.
+  auto repeat(std::size_t count) const -> PyStr;
+
+  // Appends other in place. Only for strings that nothing else can observe;
+  // a buffer still shared with other copies is copied first.
+  void append(PyStr const& other);
+
+ private:
+  // A header followed by capacity bytes of characters.
+  struct Buffer {
+    long refs;
+    std::size_t size;
+    std::size_t capacity;
+    // The number of code points, or unknown_length until first asked for.
+    std::size_t length;
+  };
+
+  static constexpr std::size_t unknown_length = -1;
+
+  static constexpr std::uint8_t size_mask = 0x1f;
+  static constexpr std::uint8_t ascii_flag = 0x20;
+  static constexpr std::uint8_t heap_flag = 0x40;
+  static constexpr std::uint8_t interned_flag = 0x80;
+
+  auto heap() const -> bool { return (meta_ & heap_flag) != 0; }
+  // A heap string keeps its buffer pointer in the inline bytes.
+  auto buffer() const -> Buffer* {
+    Buffer* buffer = nullptr;
+    std::memcpy(&buffer, small_, sizeof(buffer));
+    return buffer;
+  }
+  // Points an empty string at fresh storage for size bytes and returns it.
+  auto allocate(std::size_t size, std::size_t capacity) -> char*;
+  void release();
+
+  // Zero until the hash is first asked for.
+  mutable std::size_t hash_ = 0;
+  char small_[inline_capacity] = {};
+  std::uint8_t meta_ = ascii_flag;
 };
 
 struct PyFunction {
   FunctionDef def = {};
+  std::shared_ptr<Scope const> scope = nullptr;
+  // Bytecode for the VM, or nullptr if the function was defined by eval_stmt.
+  std::shared_ptr<Code const> code = nullptr;
+
+  // Enclosing variables, captured flat when the function is defined and
+  // indexed like scope->free. Variables that never change after capture are
+  // copied into captures, the rest are shared through cells. Both entries stay
+  // null for free names that refer to globals.
+  std::vector<std::shared_ptr<PyObj>> captures = {};
+  std::vector<std::shared_ptr<Cell>> cells = {};
+};
+
+struct PyBuiltin {
+  std::string name = "";
+  BuiltinFn fun = nullptr;
+};
+
+// A generator object. Its suspended frame lives in the VM, so a generator made
+// by either engine resumes on the VM.
+struct PyGenerator {
+  std::shared_ptr<Generator> state = nullptr;
+};
+
+// A range() object. Its values are computed as it is iterated rather than
+// stored, so iterating one allocates nothing per value.
+struct PyRange {
+  long start = 0;
+  long stop = 0;
+  long step = 1;
+};
+
+// A list. Its elements are handles held in one contiguous buffer that grows
+// geometrically, so appending takes amortised constant time.
+struct PyList {
+  std::vector<std::shared_ptr<PyObj>> values = {};
+};
+
+// A dict in CPython's compact layout. Entries sit densely in insertion order
+// with their hashes, and a separate open-addressed table maps hashes to entry
+// positions. Each slot of that table is 1, 2, 4 or 8 bytes, the narrowest that
+// can address every entry, so the table of a small dict fits in a cache line.
+class PyDict {
+ public:
+  struct Entry {
+    std::size_t hash;
+    std::shared_ptr<PyObj> key;
+    std::shared_ptr<PyObj> value;
+  };
+
+  auto size() const -> std::size_t { return entries_.size(); }
+  auto empty() const -> bool { return entries_.empty(); }
+  // In insertion order.
+  auto entries() const -> std::vector<Entry> const& { return entries_; }
+  // The width in bytes of a slot of the index table.
+  auto index_width() const -> int { return width_; }
+
+  // The value for key, or nullptr if there is none. Throws if key cannot be
+  // hashed.
+  auto get(PyObj const& key) const -> std::shared_ptr<PyObj>;
+  // The stored value for key, to be updated in place, or nullptr if there is
+  // none. Valid until the dict is next modified.
+  auto lookup(PyObj const& key) -> std::shared_ptr<PyObj>*;
+  void set(std::shared_ptr<PyObj> key, std::shared_ptr<PyObj> value);
+
+ private:
+  // Returns the entry matching key, or -1 with slot set to the empty slot
+  // where it would go.
+  auto find(PyObj const& key, std::size_t hash, std::size_t& slot) const
+      -> long;
+  // Rebuilds the index table with the given number of slots.
+  void resize(std::size_t slots);
+
+  std::vector<Entry> entries_ = {};
+  std::vector<unsigned char> index_ = {};
+  int width_ = 1;
+  // While every key is a string, lookups compare strings directly.
+  bool str_keys_ = true;
+};
+
+// An immutable tuple. Its elements are stored inline after a small header,
+// in a block shared by every copy. Blocks for tuples of up to max_pooled
+// elements are recycled through per-size free lists, so building the pairs
+// that functions return rarely reaches the allocator, and the empty tuple
+// allocates nothing.
+class PyTuple {
+ public:
+  static constexpr std::size_t max_pooled = 8;
+
+  PyTuple() = default;
+  // Moves size values from values.
+  PyTuple(std::shared_ptr<PyObj>* values, std::size_t size);
+  PyTuple(std::initializer_list<std::shared_ptr<PyObj>> values);
+  PyTuple(PyTuple const& other);
+  PyTuple(PyTuple&& other) noexcept;
+  auto operator=(PyTuple const& other) -> PyTuple&;
+  auto operator=(PyTuple&& other) noexcept -> PyTuple&;
+  ~PyTuple();
+
+  auto size() const -> std::size_t { return block_ ? block_->size : 0; }
+  auto empty() const -> bool { return size() == 0; }
+  auto begin() const -> std::shared_ptr<PyObj> const* { return items(); }
+  auto end() const -> std::shared_ptr<PyObj> const* {
+    return items() + size();
+  }
+  auto operator[](std::size_t i) const -> std::shared_ptr<PyObj> const& {
+    return items()[i];
+  }
+
+ private:
+  struct Block {
+    // While on a free list, the next free block of the same size.
+    union {
+      long refs;
+      Block* next;
+    };
+    std::size_t size;
+  };
+
+  struct Pool;
+
+  static auto pool() -> Pool&;
+  // A block for size elements, all null.
+  static auto allocate(std::size_t size) -> Block*;
+  auto items() const -> std::shared_ptr<PyObj>* {
+    return block_ ? reinterpret_cast<std::shared_ptr<PyObj>*>(block_ + 1)
+                  : nullptr;
+  }
+  void release();
+
+  Block* block_ = nullptr;
 };
 
 struct Return {
@@ -163,6 +476,7 @@ struct Return {
 struct Stack {
   BindingMap globals = {};
   BindingMap locals = {};
+  CellMap cells = {};
   std::vector<std::string> call_stack = {};
 };
 
@@ -171,60 +485,226 @@ struct Str {
   Metadata meta = {};
 };
 
+// value[index]. Python's Index node is folded into index.
+struct Subscript {
+  std::shared_ptr<Expression> value = nullptr;
+  std::shared_ptr<Expression> index = nullptr;
+  Metadata meta = {};
+};
+
+struct Tuple {
+  std::vector<Expression> elts = {};
+  Metadata meta = {};
+};
+
+struct While {
+  std::shared_ptr<Expression> test = nullptr;
+  std::vector<Statement> body = {};
+  // Runs once the test is false.
+  std::vector<Statement> or_else = {};
+  Metadata meta = {};
+};
+
+struct Yield {
+  std::shared_ptr<Expression> value = nullptr;
+  Metadata meta = {};
+};
+
 void eval_ast(Module const& ast, Stack& stack);
 
-auto eval_expr(Expression const& expr, Stack const& stack = {})
-    -> std::shared_ptr<PyObj>;
-auto eval_expr(BoolOp const& expr, Stack const& stack = {})
-    -> std::shared_ptr<PyObj>;
-auto eval_expr(BinOp const& expr, Stack const& stack = {})
+// The builtin functions, found when a global name is not bound.
+auto builtins() -> BindingMap const&;
+auto lookup_global(std::string const& name, Stack const& stack)
     -> std::shared_ptr<PyObj>;
-auto eval_expr(Compare const& expr, Stack const& stack = {})
-    -> std::shared_ptr<PyObj>;
-auto eval_expr(Num const& expr, Stack const& stack = {})
-    -> std::shared_ptr<PyObj>;
-auto eval_expr(Str const& expr, Stack const& stack = {})
-    -> std::shared_ptr<PyObj>;
-auto eval_expr(Name const& expr, Stack const& stack = {})
-    -> std::shared_ptr<PyObj>;
-auto eval_expr(NameConstant const& expr, Stack const& stack = {})
+
+auto eval_expr(Expression const& expr, Stack& stack) -> std::shared_ptr<PyObj>;
+auto eval_expr(BoolOp const& expr, Stack& stack) -> std::shared_ptr<PyObj>;
+auto eval_expr(BinOp const& expr, Stack& stack) -> std::shared_ptr<PyObj>;
+auto eval_expr(Call const& expr, Stack& stack) -> std::shared_ptr<PyObj>;
+auto eval_expr(Compare const& expr, Stack& stack) -> std::shared_ptr<PyObj>;
+auto eval_expr(Num const& expr, Stack& stack) -> std::shared_ptr<PyObj>;
+auto eval_expr(Str const& expr, Stack& stack) -> std::shared_ptr<PyObj>;
+auto eval_expr(Name const& expr, Stack& stack) -> std::shared_ptr<PyObj>;
+auto eval_expr(NameConstant const& expr, Stack& stack)
     -> std::shared_ptr<PyObj>;
+auto eval_expr(Yield const& expr, Stack& stack) -> std::shared_ptr<PyObj>;
+auto eval_expr(Attribute const& expr, Stack& stack) -> std::shared_ptr<PyObj>;
+auto eval_expr(List const& expr, Stack& stack) -> std::shared_ptr<PyObj>;
+auto eval_expr(ListComp const& expr, Stack& stack) -> std::shared_ptr<PyObj>;
+auto eval_expr(Subscript const& expr, Stack& stack) -> std::shared_ptr<PyObj>;
+auto eval_expr(Dict const& expr, Stack& stack) -> std::shared_ptr<PyObj>;
+auto eval_expr(Tuple const& expr, Stack& stack) -> std::shared_ptr<PyObj>;
 
 void eval_stmt(Statement const& stmt, Stack& stack);
 void eval_stmt(FunctionDef const& stmt, Stack& stack);
 void eval_stmt(Return const& stmt, Stack& stack);
 void eval_stmt(Assign const& stmt, Stack& stack);
+void eval_stmt(AugAssign const& stmt, Stack& stack);
 void eval_stmt(If const& stmt, Stack& stack);
 void eval_stmt(Expr const& stmt, Stack& stack);
 void eval_stmt(Print const& stmt, Stack& stack);
+void eval_stmt(While const& stmt, Stack& stack);
+void eval_stmt(For const& stmt, Stack& stack);
 
 auto add(PyObj const& a, PyObj const& b) -> PyObj;
 auto add(PyInt const& a, PyInt const& b) -> PyObj;
+auto add(PyFloat const& a, PyFloat const& b) -> PyObj;
 auto add(PyStr const& a, PyStr const& b) -> PyObj;
+auto add(PyList const& a, PyList const& b) -> PyObj;
+auto add(PyTuple const& a, PyTuple const& b) -> PyObj;
+
+// Looks the operator up in a table indexed by the operands' type tags. Bools
+// are accepted wherever ints are.
+auto binary_op(Op op, PyObj const& a, PyObj const& b) -> PyObj;
+// As above, but when a is a string that nothing else holds, a + b appends to
+// it in place and returns a. Repeated concatenation onto a temporary then
+// takes amortised linear time.
+auto binary_op(Op op, std::shared_ptr<PyObj> a, PyObj const& b)
+    -> std::shared_ptr<PyObj>;
+// target op= b, where target is the binding the result replaces. A list is
+// extended in place by a list or tuple, as in Python. An int, float or string
+// that nothing but target holds is updated in place rather than replaced.
+void inplace_op(Op op, std::shared_ptr<PyObj>& target, PyObj const& b);
+// value[index] op= b, updating the stored item as inplace_op does.
+void inplace_subscript(Op op, PyObj& value, PyObj const& index,
+                       PyObj const& b);
+
+// Calls self.name(*args). Only list.append and dict.get exist so far.
+auto call_method(std::shared_ptr<PyObj> const& self, std::string const& name,
+                 std::vector<std::shared_ptr<PyObj>> const& args)
+    -> std::shared_ptr<PyObj>;
+
+auto bit_and(PyObj const& a, PyObj const& b) -> PyObj;
+auto bit_and(PyInt const& a, PyInt const& b) -> PyObj;
+auto bit_and(PyBool const& a, PyBool const& b) -> PyObj;
+
+auto bit_or(PyObj const& a, PyObj const& b) -> PyObj;
+auto bit_or(PyInt const& a, PyInt const& b) -> PyObj;
+auto bit_or(PyBool const& a, PyBool const& b) -> PyObj;
+
+auto bit_xor(PyObj const& a, PyObj const& b) -> PyObj;
+auto bit_xor(PyInt const& a, PyInt const& b) -> PyObj;
+auto bit_xor(PyBool const& a, PyBool const& b) -> PyObj;
 
 auto cmp(PyObj const& a, PyObj const& b) -> int;
 auto cmp(PyStr const& a, PyStr const& b) -> int;
 auto cmp(PyInt const& a, PyInt const& b) -> int;
+auto cmp(PyFloat const& a, PyFloat const& b) -> int;
+// Exact, even for ints too large to convert to a float without rounding.
+auto cmp(PyInt const& a, PyFloat const& b) -> int;
+auto cmp(PyFloat const& a, PyInt const& b) -> int;
+// Lexicographic, element by element.
+auto cmp(PyList const& a, PyList const& b) -> int;
+auto cmp(PyTuple const& a, PyTuple const& b) -> int;
+
+// `is` compares the objects a and b refer to, so they must be the operands
+// themselves rather than copies.
+auto compare_op(CmpOp op, PyObj const& a, PyObj const& b) -> bool;
+// The shared True or False. Comparisons return these rather than allocating.
+auto py_bool(bool value) -> std::shared_ptr<PyObj>;
+
+// The `in` operator. For strings, whether item is a substring.
+auto contains(PyObj const& container, PyObj const& item) -> bool;
+auto contains(PyStr const& s, PyStr const& sub) -> bool;
+auto contains(PyRange const& r, PyInt const& i) -> bool;
+auto contains(PyList const& l, PyObj const& item) -> bool;
+auto contains(PyDict const& d, PyObj const& key) -> bool;
+auto contains(PyTuple const& t, PyObj const& item) -> bool;
+
+// The number of values a range yields.
+auto length(PyRange const& r) -> unsigned long;
+// len(obj), which is defined for strings, ranges, lists, tuples and dicts.
+auto length(PyObj const& obj) -> unsigned long;
 
 auto div(PyObj const& a, PyObj const& b) -> PyObj;
+// True division. Ints divide to a correctly rounded float.
 auto div(PyInt const& a, PyInt const& b) -> PyObj;
+auto div(PyFloat const& a, PyFloat const& b) -> PyObj;
+
+// Rounds toward negative infinity, as in Python.
+auto floor_div(PyObj const& a, PyObj const& b) -> PyObj;
+auto floor_div(PyInt const& a, PyInt const& b) -> PyObj;
+auto floor_div(PyFloat const& a, PyFloat const& b) -> PyObj;
+
+auto lshift(PyObj const& a, PyObj const& b) -> PyObj;
+auto lshift(PyInt const& a, PyInt const& b) -> PyObj;
+
+// The result takes the sign of the divisor, as in Python.
+auto mod(PyObj const& a, PyObj const& b) -> PyObj;
+auto mod(PyInt const& a, PyInt const& b) -> PyObj;
+auto mod(PyFloat const& a, PyFloat const& b) -> PyObj;
 
 auto mul(PyObj const& a, PyObj const& b) -> PyObj;
+// Repetition. Counts below one give the empty string.
 auto mul(PyStr const& a, PyInt const& b) -> PyObj;
+auto mul(PyInt const& a, PyStr const& b) -> PyObj;
 auto mul(PyInt const& a, PyInt const& b) -> PyObj;
+auto mul(PyFloat const& a, PyFloat const& b) -> PyObj;
+
+auto pow(PyObj const& a, PyObj const& b) -> PyObj;
+auto pow(PyInt const& a, PyInt const& b) -> PyObj;
+auto pow(PyFloat const& a, PyFloat const& b) -> PyObj;
+// The three-argument pow(): base ** exp % m without the full power.
+auto pow_mod(PyObj const& base, PyObj const& exp, PyObj const& m) -> PyObj;
+auto pow_mod(PyInt const& base, PyInt const& exp, PyInt const& m) -> PyObj;
+
+// Writes str(obj) to out. Numbers are formatted in a stack buffer instead of
+// going through a PyStr.
+void print(std::ostream& out, PyObj const& obj);
+
+// The representation of obj inside a list. Strings are quoted, and
+// everything else is as str() gives it.
+auto repr(PyObj const& obj) -> PyStr;
+
+auto rshift(PyObj const& a, PyObj const& b) -> PyObj;
+auto rshift(PyInt const& a, PyInt const& b) -> PyObj;
+
+// The value of a string literal. Identifier-like literals, the kind compared
+// against each other as tags, are interned.
+auto literal_str(std::string const& s) -> PyStr;
+// String equality, which needs no bytes compared for two interned strings.
+auto equal(PyStr const& a, PyStr const& b) -> bool;
+// Python's ==, where values of types that cannot be compared are unequal.
+auto equal(PyObj const& a, PyObj const& b) -> bool;
+
+// Python's hash(). Numbers that compare equal hash equally, whatever their
+// types. Throws for lists and dicts, and tuples holding them.
+auto hash(PyObj const& obj) -> std::size_t;
 
 auto str(PyObj const& term) -> PyStr;
 auto str(PyNoneType const& n) -> PyStr;
 auto str(PyBool const& b) -> PyStr;
 auto str(PyInt const& i) -> PyStr;
+auto str(PyFloat const& f) -> PyStr;
 auto str(PyStr const& str) -> PyStr;
+auto str(PyRange const& r) -> PyStr;
+auto str(PyList const& l) -> PyStr;
+auto str(PyDict const& d) -> PyStr;
+auto str(PyTuple const& t) -> PyStr;
+
+// value[index] and value[index] = item. Negative indices count from the end.
+auto subscript(PyObj const& value, PyObj const& index)
+    -> std::shared_ptr<PyObj>;
+void store_subscript(PyObj& value, std::shared_ptr<PyObj> index,
+                     std::shared_ptr<PyObj> item);
 
 auto sub(PyObj const& a, PyObj const& b) -> PyObj;
 auto sub(PyInt const& a, PyInt const& b) -> PyObj;
+auto sub(PyFloat const& a, PyFloat const& b) -> PyObj;
 
 auto truth_value(PyObj const& term) -> bool;
+auto truth_value(PyBool const& b) -> bool;
 auto truth_value(PyInt const& i) -> bool;
+auto truth_value(PyFloat const& f) -> bool;
 auto truth_value(PyStr const& str) -> bool;
+auto truth_value(PyRange const& r) -> bool;
+auto truth_value(PyList const& l) -> bool;
+auto truth_value(PyDict const& d) -> bool;
+auto truth_value(PyTuple const& t) -> bool;
+
+// The n elements of a tuple or list, in place, for unpacking into n targets.
+// Throws for other types, or if there are more or fewer.
+auto unpack(PyObj const& value, std::size_t n) -> std::shared_ptr<PyObj> const*;
 }  // namespace MyPython
 
 #endif
@@ -0,0 +1,62 @@
+#ifndef COSC4315HW2_SRC_MYPYTHON_BIGINT_HPP_
+#define COSC4315HW2_SRC_MYPYTHON_BIGINT_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <mypython/ast.hpp>
+
+namespace MyPython {
+// An integer of any size, as a sign and a magnitude. The magnitude is held in
+// base 2^32, least significant limb first, with no high zero limbs; zero has
+// no limbs and is never negative.
+struct BigInt {
+  bool negative = false;
+  std::vector<std::uint32_t> limbs = {};
+};
+
+// Operands with at least this many limbs are multiplied with Karatsuba's
+// algorithm rather than schoolbook multiplication.
+constexpr int karatsuba_threshold = 32;
+
+auto make_bigint(long value) -> BigInt;
+auto make_bigint(PyInt const& i) -> BigInt;
+auto fits_long(BigInt const& a) -> bool;
+auto to_long(BigInt const& a) -> long;
+// Demotes to an inline PyInt when the value fits in a long.
+auto make_int(BigInt value) -> PyInt;
+// Rounds toward zero. Throws for infinities and NaN.
+auto truncate_to_bigint(double value) -> BigInt;
+// Rounds to nearest. Throws if the result would be infinite.
+auto to_double(BigInt const& a) -> double;
+// a / b, correctly rounded for results in the normal range.
+auto true_div(BigInt const& a, BigInt const& b) -> double;
+
+auto add(BigInt const& a, BigInt const& b) -> BigInt;
+auto sub(BigInt const& a, BigInt const& b) -> BigInt;
+auto mul(BigInt const& a, BigInt const& b) -> BigInt;
+auto cmp(BigInt const& a, BigInt const& b) -> int;
+
+// Division rounds toward negative infinity and the remainder takes the sign
+// of the divisor, as in Python. Both throw on a zero divisor.
+auto floor_div(BigInt const& a, BigInt const& b) -> BigInt;
+auto mod(BigInt const& a, BigInt const& b) -> BigInt;
+
+auto pow(BigInt const& base, unsigned long exp) -> BigInt;
+// base ** exp % m, reducing after every step. A negative exp raises the
+// inverse of base modulo m, and throws if base has none.
+auto pow_mod(BigInt const& base, BigInt const& exp, BigInt const& m) -> BigInt;
+
+// Shifts and bitwise operators act on an infinite two's complement
+// representation, so a right shift of a negative value rounds down.
+auto lshift(BigInt const& a, unsigned long count) -> BigInt;
+auto rshift(BigInt const& a, unsigned long count) -> BigInt;
+auto bit_and(BigInt const& a, BigInt const& b) -> BigInt;
+auto bit_or(BigInt const& a, BigInt const& b) -> BigInt;
+auto bit_xor(BigInt const& a, BigInt const& b) -> BigInt;
+
+auto to_string(BigInt const& a) -> std::string;
+}  // namespace MyPython
+
+#endif
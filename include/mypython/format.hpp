@@ -0,0 +1,28 @@
+#ifndef COSC4315HW2_SRC_MYPYTHON_FORMAT_HPP_
+#define COSC4315HW2_SRC_MYPYTHON_FORMAT_HPP_
+
+#include <cstdint>
+#include <string>
+
+namespace MyPython {
+// Room for the longest long, "-9223372036854775808".
+constexpr int int_chars = 24;
+// Room for the longest float output, "-2.2250738585072014e-308".
+constexpr int float_chars = 32;
+
+// Writes the shortest decimal that reads back as value, laid out as Python's
+// repr() lays it out, and returns the end of the output. The digits come from
+// the Ryu algorithm, so no arbitrary-precision arithmetic is needed.
+auto format_float(double value, char* out) -> char*;
+auto format_float(double value) -> std::string;
+
+// Writes value in decimal and returns the end of the output. Digits are
+// produced two at a time from a table of pairs.
+auto format_int(long value, char* out) -> char*;
+auto format_int(long value) -> std::string;
+// Writes exactly width digits of value, padding with leading zeros. value
+// must have no more than width digits.
+auto format_padded(std::uint64_t value, int width, char* out) -> char*;
+}  // namespace MyPython
+
+#endif
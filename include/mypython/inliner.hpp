@@ -0,0 +1,41 @@
+#ifndef COSC4315HW2_SRC_MYPYTHON_INLINER_HPP_
+#define COSC4315HW2_SRC_MYPYTHON_INLINER_HPP_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <mypython/ast.hpp>
+
+namespace MyPython {
+struct InlineOptions {
+  // Largest callee body, counted in AST nodes, that is substituted at its
+  // call sites.
+  int max_size = 24;
+};
+
+struct InlinedCall {
+  std::string callee = "";
+  // The enclosing function, or "<module>" for top-level code.
+  std::string caller = "";
+  int size = 0;
+};
+
+struct InlineReport {
+  std::vector<InlinedCall> inlined = {};
+  // Module-level functions that were not eligible, mapped to the reason.
+  std::map<std::string, std::string> rejected = {};
+};
+
+// Substitutes the bodies of small, non-recursive leaf functions at their call
+// sites. A function is eligible when it is defined once at module level, its
+// body is a run of single-name assignments ending in a return, and it makes no
+// calls of its own. The callee's parameters and locals are renamed to fresh
+// names that cannot collide with any Python identifier. Only a callee made of
+// a single return with trivial arguments is substituted at module level, where
+// fresh names would be globals.
+auto inline_functions(Module const& ast, InlineReport& report,
+                      InlineOptions const& options = {}) -> Module;
+}  // namespace MyPython
+
+#endif
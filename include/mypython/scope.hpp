@@ -0,0 +1,36 @@
+#ifndef COSC4315HW2_SRC_MYPYTHON_SCOPE_HPP_
+#define COSC4315HW2_SRC_MYPYTHON_SCOPE_HPP_
+
+#include <string>
+#include <vector>
+
+#include <mypython/ast.hpp>
+
+namespace MyPython {
+// The names a function body binds and the names it reads from outside.
+struct Scope {
+  // Parameters first, then every other bound name in order of first binding.
+  // A name's position in this list is its local slot.
+  std::vector<std::string> locals = {};
+  // Names read by the body, or by a nested function, that the body never
+  // binds. These resolve to an enclosing function or to the globals.
+  std::vector<std::string> free = {};
+  // Locals captured by a nested function that may change after the nested
+  // function is defined. These are shared through cells; every other captured
+  // local is copied into the closure when it is defined.
+  std::vector<std::string> cells = {};
+  // Whether the body yields, making every call return a generator.
+  bool generator = false;
+};
+
+auto resolve_scope(FunctionDef const& def) -> Scope;
+
+auto is_local(Scope const& scope, std::string const& name) -> bool;
+auto is_free(Scope const& scope, std::string const& name) -> bool;
+auto is_cell(Scope const& scope, std::string const& name) -> bool;
+
+// Returns the slot of a local, or -1 if the name is not local.
+auto slot_of(Scope const& scope, std::string const& name) -> int;
+}  // namespace MyPython
+
+#endif
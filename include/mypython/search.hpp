@@ -0,0 +1,30 @@
+#ifndef COSC4315HW2_SRC_MYPYTHON_SEARCH_HPP_
+#define COSC4315HW2_SRC_MYPYTHON_SEARCH_HPP_
+
+#include <cstddef>
+
+namespace MyPython {
+// Returned when the needle does not occur.
+constexpr std::size_t not_found = static_cast<std::size_t>(-1);
+
+// Each returns the offset of the first occurrence of needle in haystack, or
+// not_found. The vector versions test 16 or 32 positions at once by matching
+// the needle's first and last bytes, and compare the rest only where both
+// match.
+auto find_scalar(char const* haystack, std::size_t n, char const* needle,
+                 std::size_t k) -> std::size_t;
+#if defined(__x86_64__) || defined(__i386__)
+auto find_sse2(char const* haystack, std::size_t n, char const* needle,
+               std::size_t k) -> std::size_t;
+// Only call when has_avx2().
+auto find_avx2(char const* haystack, std::size_t n, char const* needle,
+               std::size_t k) -> std::size_t;
+auto has_avx2() -> bool;
+#endif
+
+// The fastest of the above that the CPU supports, chosen once at startup.
+auto find(char const* haystack, std::size_t n, char const* needle,
+          std::size_t k) -> std::size_t;
+}  // namespace MyPython
+
+#endif
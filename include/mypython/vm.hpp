@@ -0,0 +1,202 @@
+#ifndef COSC4315HW2_SRC_MYPYTHON_VM_HPP_
+#define COSC4315HW2_SRC_MYPYTHON_VM_HPP_
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <mypython/ast.hpp>
+
+namespace MyPython {
+enum class OpCode {
+  load_const,     // Push consts[arg].
+  load_fast,      // Push slot arg.
+  store_fast,     // Pop into slot arg.
+  swap_fast,      // Exchange slots arg & 0xffff and unsigned(arg) >> 16.
+  load_deref,     // Push the value of the cell for slot arg.
+  store_deref,    // Pop into the cell for slot arg.
+  load_free,      // Push captured free variable arg, or the global it names.
+  load_global,    // Push the global names[arg].
+  store_global,   // Pop into the global names[arg].
+  pop_top,        // Discard the top of the operand stack.
+  dup_top,        // Push the top of the operand stack again.
+  binary_op,      // Pop b, a and push binary_op(Op(arg), a, b).
+  compare_op,     // Pop b, a and push compare_op(CmpOp(arg), a, b).
+  compare_link,   // Pop b, a. If compare_op(CmpOp(arg), a, b), push b for the
+                  // next link and skip the next instruction. Otherwise push
+                  // False and run it, a jump past the rest of the chain.
+  jump,           // Continue at arg.
+  jump_if_false,  // Pop a value and continue at arg if it is falsy.
+  jump_table,     // Pop a value and continue where jump_tables[arg] sends it.
+  jump_if_false_or_pop,  // Continue at arg if the top value is falsy, and
+                         // pop it otherwise.
+  jump_if_true_or_pop,   // Continue at arg if the top value is truthy, and
+                         // pop it otherwise.
+  make_function,  // Push a function built from functions[arg].
+  call,           // Pop the arguments and callee of call_sites[arg] and enter.
+  call_method,    // Pop the arguments and object of call_sites[arg] and call
+                  // its method.
+  return_value,   // Pop a value and return it to the caller.
+  print_space,    // Write a separator to files[arg].
+  print_item,     // Pop a value and write its str() to files[arg].
+  print_newline,  // Write a newline to files[arg].
+  yield_value,    // Pop a value and suspend the generator, yielding it.
+  get_iter,       // Pop an iterable and start a loop over it. If arg is 1,
+                  // reserve room for its values in the list below it.
+  for_iter,       // Push the loop's next value, or end the loop at arg.
+  get_counter,    // Pop an iterable and start a loop over it like get_iter. A
+                  // range is counted into slot arg by next_count.
+  next_count,     // If the innermost loop is counted and has values left,
+                  // store the next into its slot and continue at arg.
+  jump_if_not_range,  // Pop a value and continue at arg unless it is the
+                      // builtin range.
+  build_list,     // Pop arg values and push a list of them.
+  build_map,      // Pop arg keys, each followed by its value, and push a dict.
+  build_tuple,    // Pop arg values and push a tuple of them.
+  unpack_sequence,  // Pop a tuple or list of arg values and push them, last
+                    // first.
+  list_append,    // Pop a value and append it to the list below it.
+  binary_subscr,  // Pop index, value and push value[index].
+  store_subscr,   // Pop index, value, item and set value[index] = item.
+  inplace_fast,   // Pop b and apply Op(arg & 0xf) in place to slot arg >> 4.
+  inplace_deref,  // Pop b and apply Op(arg & 0xf) in place to the cell for
+                  // slot arg >> 4.
+  inplace_global,  // Pop b and apply Op(arg & 0xf) in place to the global
+                   // names[arg >> 4].
+  inplace_subscr   // Pop b, index, value and apply Op(arg) in place to
+                   // value[index].
+};
+
+struct Instr {
+  OpCode op = OpCode::pop_top;
+  int arg = 0;
+};
+
+// What a call site has learned about the functions it calls.
+struct CallSite {
+  int argc = 0;
+  // For a method call, the index in names of the method.
+  int method = -1;
+  // The callee whose arity was last checked here. Calls to the same code skip
+  // the check.
+  std::weak_ptr<Code const> checked = {};
+};
+
+// Where an if/elif chain that compares one name with distinct int or string
+// literals continues for each value of the name.
+struct JumpTable {
+  // Where a value that equals none of the literals goes.
+  int default_target = 0;
+  // The first literal. A value of a type none of them has is compared with
+  // it, as the chain's first test would, in case that throws.
+  std::shared_ptr<PyObj> first = nullptr;
+  // For ints that span a short range, the target for low + i, or -1 if that
+  // value has no case of its own. Empty otherwise.
+  long low = 0;
+  std::vector<int> dense = {};
+  // Otherwise, a perfect hash: keys[(hash >> shift) & (keys.size() - 1)] is
+  // the only literal a value of that hash can equal, and targets holds where
+  // each slot's case starts.
+  int shift = 0;
+  std::vector<std::shared_ptr<PyObj>> keys = {};
+  std::vector<int> targets = {};
+};
+
+struct Code {
+  std::string name = "<module>";
+  // The resolved scope of a function body, or nullptr for a module.
+  std::shared_ptr<Scope const> scope = nullptr;
+
+  // A function frame holds one slot per local, parameters first, followed by
+  // one per free variable. Slots listed in cell_slots are kept in cells.
+  int nlocals = 0;
+  int nslots = 0;
+  std::vector<int> cell_slots = {};
+
+  std::vector<Instr> instrs = {};
+  std::vector<std::shared_ptr<PyObj>> consts = {};
+  std::vector<std::string> names = {};
+  std::vector<std::ostream*> files = {};
+  std::vector<JumpTable> jump_tables = {};
+
+  // Nested function definitions and their compiled bodies. For each, the
+  // slot of this frame that holds each of its free variables, or -1 for those
+  // that are globals.
+  std::vector<FunctionDef> defs = {};
+  std::vector<std::shared_ptr<Code const>> functions = {};
+  std::vector<std::vector<int>> captures = {};
+
+  mutable std::vector<CallSite> call_sites = {};
+};
+
+// A loop in progress. Ranges, strings, lists and dicts are stepped by index,
+// so a loop over range() holds no list and allocates no index objects.
+struct Iterator {
+  std::shared_ptr<PyObj> iterable = nullptr;
+  long next = 0;
+  long step = 1;
+  unsigned long remaining = 0;
+  // For a counted loop over a range, the slot that takes each value, or -1.
+  int slot = -1;
+};
+
+struct Frame {
+  Code const* code = nullptr;
+  // Keeps a callee's code alive for as long as it runs.
+  std::shared_ptr<Code const> owner = nullptr;
+  int pc = 0;
+  std::vector<std::shared_ptr<PyObj>> slots = {};
+  // Cells for the slots shared with closures. Empty if there are none.
+  std::vector<std::shared_ptr<Cell>> cells = {};
+  std::vector<std::shared_ptr<PyObj>> values = {};
+  // The loops in progress, innermost last.
+  std::vector<Iterator> iterators = {};
+  // The generator this frame belongs to, set only while it runs.
+  std::shared_ptr<Generator> generator = nullptr;
+};
+
+struct Generator {
+  // The suspended frame. It moves onto the VM's frame stack to resume and
+  // back when the body yields, so its slots are never copied.
+  Frame frame = {};
+  bool started = false;
+  bool running = false;
+  bool finished = false;
+};
+
+struct VMOptions {
+  // Deepest Python call nesting allowed. Frames live on the heap, so this can
+  // be raised far beyond what the native stack could hold.
+  int recursion_limit = 1000;
+};
+
+// Compiles to bytecode without recursing on expression depth, so arbitrarily
+// deep expression trees are accepted.
+auto compile(Module const& ast) -> std::shared_ptr<Code const>;
+auto compile(FunctionDef const& def) -> std::shared_ptr<Code const>;
+
+// Runs bytecode on an explicit, growable stack of frames. Neither expression
+// depth nor Python recursion grows the native stack.
+void execute(Code const& code, Stack& stack, VMOptions const& options = {});
+
+// Evaluates a module like eval_ast, but through the bytecode VM.
+void run(Module const& ast, Stack& stack, VMOptions const& options = {});
+
+// Builds the frame for a call to fun, moving the arguments into its slots.
+// The caller checks the arity.
+auto make_frame(PyFunction& fun, std::shared_ptr<PyObj>* args, int argc)
+    -> Frame;
+auto make_generator(PyFunction& fun, std::vector<std::shared_ptr<PyObj>>& args)
+    -> std::shared_ptr<Generator>;
+
+// Runs a generator until it yields, returning the yielded value. Throws
+// "StopIteration" once the body has returned.
+auto resume(std::shared_ptr<Generator> const& gen, Stack& stack,
+            VMOptions const& options = {}) -> std::shared_ptr<PyObj>;
+// Like resume, but returns nullptr once the body has returned.
+auto try_resume(std::shared_ptr<Generator> const& gen, Stack& stack,
+                VMOptions const& options = {}) -> std::shared_ptr<PyObj>;
+}  // namespace MyPython
+
+#endif
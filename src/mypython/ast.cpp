@@ -1,15 +1,22 @@
 #include <mypython/ast.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#include <mypython/bigint.hpp>
+#include <mypython/format.hpp>
+#include <mypython/scope.hpp>
+#include <mypython/search.hpp>
+#include <mypython/vm.hpp>
 #include <util/variant.hpp>
 
 namespace MyPython {
 // Non-matching functions.
 namespace {
-template <class T1, class T2>
-auto cmp(T1 const& a, T2 const& b) -> int {
-  throw "Error comparing two types";
-}
-
 template <class T>
 auto str(T const&) -> PyStr {
   throw "Error converting to str";
@@ -20,157 +27,575 @@ auto truth_value(T const&) -> bool {
   throw "No truth value exists";
 }
 
-template <class T1, class T2>
-auto add(T1 const& a, T2 const& b) -> PyObj {
-  throw "Cannot add two types";
+// A function's bindings are split into plain locals and the cells it shares
+// with closures, so a name is found with at most one lookup in each before
+// falling back to the globals.
+void capture(PyFunction& fun, BindingMap const& locals, CellMap const& cells) {
+  auto const& free = fun.scope->free;
+  fun.captures.resize(free.size());
+  fun.cells.resize(free.size());
+  for (int i = 0; i < free.size(); ++i) {
+    auto cell = cells.find(free[i]);
+    if (cell != cells.end()) {
+      fun.cells[i] = cell->second;
+      continue;
+    }
+    // Names bound nowhere in the enclosing function are globals.
+    auto local = locals.find(free[i]);
+    if (local != locals.end()) fun.captures[i] = local->second;
+  }
+}
+
+void enter_closure(PyFunction const& fun, BindingMap& locals, CellMap& cells) {
+  auto const& free = fun.scope->free;
+  for (int i = 0; i < fun.captures.size(); ++i) {
+    if (fun.cells[i]) {
+      cells[free[i]] = fun.cells[i];
+    } else if (fun.captures[i]) {
+      locals[free[i]] = fun.captures[i];
+    }
+  }
+  for (auto&& name : fun.scope->cells) {
+    cells[name] = std::make_shared<Cell>();
+  }
+}
+
+void bind_local(std::string const& name, std::shared_ptr<PyObj> value,
+                BindingMap& locals, CellMap& cells) {
+  auto cell = cells.find(name);
+  if (cell != cells.end()) {
+    cell->second->value = std::move(value);
+  } else {
+    locals[name] = std::move(value);
+  }
+}
+
+auto lookup_local(std::string const& name, BindingMap const& locals,
+                  CellMap const& cells) -> std::shared_ptr<PyObj> {
+  auto local = locals.find(name);
+  if (local != locals.end()) return local->second;
+
+  auto cell = cells.find(name);
+  if (cell == cells.end()) return nullptr;
+  if (!cell->second->value) throw "Free variable referenced before assignment";
+  return cell->second->value;
+}
+
+// Binds name in the innermost scope, as an assignment does.
+void bind_name(std::string const& name, std::shared_ptr<PyObj> value,
+               Stack& stack) {
+  if (stack.call_stack.empty()) {
+    stack.globals[name] = std::move(value);
+  } else {
+    bind_local(name, std::move(value), stack.locals, stack.cells);
+  }
+}
+
+void assign_target(Expression const& target, std::shared_ptr<PyObj> value,
+                   Stack& stack) {
+  auto visitor = Util::make_visitor(
+      [&](Name const& name) { bind_name(name.id, std::move(value), stack); },
+      [&](Subscript const& sub) {
+        auto container = eval_expr(*sub.value, stack);
+        auto index = eval_expr(*sub.index, stack);
+        store_subscript(*container, std::move(index), std::move(value));
+      },
+      [&](Tuple const& tuple) {
+        // Every value is taken before any is stored, as a store may modify
+        // the list being unpacked.
+        auto n = tuple.elts.size();
+        auto first = unpack(*value, n);
+        std::vector<std::shared_ptr<PyObj>> values(first, first + n);
+        for (std::size_t i = 0; i < n; ++i) {
+          assign_target(tuple.elts[i], values[i], stack);
+        }
+      },
+      [](auto const&) { throw "Not yet implemented"; });
+  mpark::visit(visitor, target);
+}
+
+// Swaps a callee's bindings into the stack for the duration of a call,
+// restoring the caller's even when the body unwinds with an exception.
+struct CallFrame {
+  CallFrame(Stack& stack, std::string const& name, BindingMap locals,
+            CellMap cells)
+      : stack(stack),
+        saved_locals(std::move(stack.locals)),
+        saved_cells(std::move(stack.cells)) {
+    stack.locals = std::move(locals);
+    stack.cells = std::move(cells);
+    stack.call_stack.push_back(name);
+  }
+
+  ~CallFrame() {
+    stack.locals = std::move(saved_locals);
+    stack.cells = std::move(saved_cells);
+    stack.call_stack.pop_back();
+  }
+
+  Stack& stack;
+  BindingMap saved_locals;
+  CellMap saved_cells;
+};
+
+// Every operator is dispatched through a dense table indexed by the type tags
+// (PyObj::index()) of its operands. A null entry means the types are
+// unsupported.
+constexpr auto type_count = mpark::variant_size<PyObj>::value;
+constexpr auto op_count = static_cast<int>(Op::floor_div) + 1;
+
+template <class R>
+using Table = std::array<std::array<R (*)(PyObj const&, PyObj const&),
+                                    type_count>,
+                         type_count>;
+
+template <class T>
+constexpr auto tag() -> std::size_t {
+  return Util::variant_index<T, PyObj>::value;
+}
+
+// Unwraps operands of types A and B for F, whose parameters may be bases of
+// them.
+template <class A, class B, class R, class P1, class P2,
+          R (*F)(P1 const&, P2 const&)>
+auto unwrap(PyObj const& a, PyObj const& b) -> R {
+  return F(*mpark::get_if<A>(&a), *mpark::get_if<B>(&b));
+}
+
+// bool is a subtype of int, so every int kernel also takes bools.
+template <class R, R (*F)(PyInt const&, PyInt const&)>
+void set_ints(Table<R>& fns) {
+  fns[tag<PyInt>()][tag<PyInt>()] = unwrap<PyInt, PyInt, R, PyInt, PyInt, F>;
+  fns[tag<PyInt>()][tag<PyBool>()] = unwrap<PyInt, PyBool, R, PyInt, PyInt, F>;
+  fns[tag<PyBool>()][tag<PyInt>()] = unwrap<PyBool, PyInt, R, PyInt, PyInt, F>;
+  fns[tag<PyBool>()][tag<PyBool>()] =
+      unwrap<PyBool, PyBool, R, PyInt, PyInt, F>;
+}
+
+auto to_float(PyFloat const& f) -> PyFloat const& { return f; }
+
+auto to_float(PyInt const& i) -> PyFloat {
+  return PyFloat(i.big ? to_double(*i.big) : static_cast<double>(i.value));
+}
+
+// Converts int and bool operands to float for F.
+template <class A, class B, PyObj (*F)(PyFloat const&, PyFloat const&)>
+auto promote(PyObj const& a, PyObj const& b) -> PyObj {
+  return F(to_float(*mpark::get_if<A>(&a)), to_float(*mpark::get_if<B>(&b)));
+}
+
+// Mixed int and float arithmetic happens in float.
+template <PyObj (*F)(PyFloat const&, PyFloat const&)>
+void set_floats(Table<PyObj>& fns) {
+  auto const f = tag<PyFloat>();
+  fns[f][f] = unwrap<PyFloat, PyFloat, PyObj, PyFloat, PyFloat, F>;
+  fns[f][tag<PyInt>()] = promote<PyFloat, PyInt, F>;
+  fns[f][tag<PyBool>()] = promote<PyFloat, PyBool, F>;
+  fns[tag<PyInt>()][f] = promote<PyInt, PyFloat, F>;
+  fns[tag<PyBool>()][f] = promote<PyBool, PyFloat, F>;
+}
+
+auto make_binary_table() -> std::array<Table<PyObj>, op_count> {
+  std::array<Table<PyObj>, op_count> table = {};
+  auto fns = [&](Op op) -> Table<PyObj>& {
+    return table[static_cast<int>(op)];
+  };
+
+  set_ints<PyObj, add>(fns(Op::add));
+  set_ints<PyObj, sub>(fns(Op::sub));
+  set_ints<PyObj, mul>(fns(Op::mul));
+  set_ints<PyObj, div>(fns(Op::div));
+  set_ints<PyObj, mod>(fns(Op::mod));
+  set_ints<PyObj, pow>(fns(Op::pow));
+  set_ints<PyObj, lshift>(fns(Op::lshift));
+  set_ints<PyObj, rshift>(fns(Op::rshift));
+  set_ints<PyObj, bit_or>(fns(Op::bit_or));
+  set_ints<PyObj, bit_xor>(fns(Op::bit_xor));
+  set_ints<PyObj, bit_and>(fns(Op::bit_and));
+  set_ints<PyObj, floor_div>(fns(Op::floor_div));
+
+  set_floats<add>(fns(Op::add));
+  set_floats<sub>(fns(Op::sub));
+  set_floats<mul>(fns(Op::mul));
+  set_floats<div>(fns(Op::div));
+  set_floats<mod>(fns(Op::mod));
+  set_floats<pow>(fns(Op::pow));
+  set_floats<floor_div>(fns(Op::floor_div));
+
+  // Bitwise operators on two bools give a bool.
+  auto const b = tag<PyBool>();
+  fns(Op::bit_or)[b][b] = unwrap<PyBool, PyBool, PyObj, PyBool, PyBool, bit_or>;
+  fns(Op::bit_xor)[b][b] =
+      unwrap<PyBool, PyBool, PyObj, PyBool, PyBool, bit_xor>;
+  fns(Op::bit_and)[b][b] =
+      unwrap<PyBool, PyBool, PyObj, PyBool, PyBool, bit_and>;
+
+  auto const i = tag<PyInt>();
+  auto const s = tag<PyStr>();
+  fns(Op::add)[s][s] = unwrap<PyStr, PyStr, PyObj, PyStr, PyStr, add>;
+  fns(Op::mul)[s][i] = unwrap<PyStr, PyInt, PyObj, PyStr, PyInt, mul>;
+  fns(Op::mul)[s][b] = unwrap<PyStr, PyBool, PyObj, PyStr, PyInt, mul>;
+  fns(Op::mul)[i][s] = unwrap<PyInt, PyStr, PyObj, PyInt, PyStr, mul>;
+  fns(Op::mul)[b][s] = unwrap<PyBool, PyStr, PyObj, PyInt, PyStr, mul>;
+
+  auto const l = tag<PyList>();
+  fns(Op::add)[l][l] = unwrap<PyList, PyList, PyObj, PyList, PyList, add>;
+  auto const t = tag<PyTuple>();
+  fns(Op::add)[t][t] = unwrap<PyTuple, PyTuple, PyObj, PyTuple, PyTuple, add>;
+  return table;
+}
+
+auto make_compare_table() -> Table<int> {
+  Table<int> fns = {};
+  set_ints<int, cmp>(fns);
+
+  auto const f = tag<PyFloat>();
+  fns[f][f] = unwrap<PyFloat, PyFloat, int, PyFloat, PyFloat, cmp>;
+  fns[f][tag<PyInt>()] = unwrap<PyFloat, PyInt, int, PyFloat, PyInt, cmp>;
+  fns[f][tag<PyBool>()] = unwrap<PyFloat, PyBool, int, PyFloat, PyInt, cmp>;
+  fns[tag<PyInt>()][f] = unwrap<PyInt, PyFloat, int, PyInt, PyFloat, cmp>;
+  fns[tag<PyBool>()][f] = unwrap<PyBool, PyFloat, int, PyInt, PyFloat, cmp>;
+
+  auto const s = tag<PyStr>();
+  fns[s][s] = unwrap<PyStr, PyStr, int, PyStr, PyStr, cmp>;
+
+  auto const l = tag<PyList>();
+  fns[l][l] = unwrap<PyList, PyList, int, PyList, PyList, cmp>;
+  auto const t = tag<PyTuple>();
+  fns[t][t] = unwrap<PyTuple, PyTuple, int, PyTuple, PyTuple, cmp>;
+  return fns;
+}
+
+auto const binary_table = make_binary_table();
+auto const compare_table = make_compare_table();
+
+char const* const binary_errors[op_count] = {
+    "Cannot add two types",    "Cannot sub two types",
+    "Cannot mul two types",    "Cannot mat_mult two types",
+    "Cannot div two types",    "Cannot mod two types",
+    "Cannot pow two types",    "Cannot lshift two types",
+    "Cannot rshift two types", "Cannot bit_or two types",
+    "Cannot bit_xor two types", "Cannot bit_and two types",
+    "Cannot floor_div two types"};
+
+// Singletons and small ints are identical whenever they are equal, as in
+// CPython. Anything else is identical only to itself.
+auto identical(PyObj const& a, PyObj const& b) -> bool {
+  if (&a == &b) return true;
+  if (a.index() != b.index()) return false;
+  if (mpark::holds_alternative<PyNoneType>(a)) return true;
+  if (auto x = mpark::get_if<PyBool>(&a)) {
+    return x->value == mpark::get<PyBool>(b).value;
+  }
+  if (auto x = mpark::get_if<PyInt>(&a)) {
+    auto const& y = mpark::get<PyInt>(b);
+    return !x->big && !y.big && x->value == y.value && x->value >= -5 &&
+           x->value <= 256;
+  }
+  return false;
+}
+
+auto is_nan(PyObj const& obj) -> bool {
+  auto f = mpark::get_if<PyFloat>(&obj);
+  return f != nullptr && std::isnan(f->value);
 }
 
-template <class T1, class T2>
-auto sub(T1 const& a, T2 const& b) -> PyObj {
-  throw "Cannot add sub types";
+// Splits a / b into a floored quotient and a remainder with the sign of b,
+// as Python does for floats.
+void float_divmod(double a, double b, double& quot, double& rem) {
+  if (b == 0) throw "Division by zero";
+  rem = std::fmod(a, b);
+  quot = (a - rem) / b;
+  if (rem != 0) {
+    if ((b < 0) != (rem < 0)) {
+      rem += b;
+      quot -= 1.0;
+    }
+  } else {
+    rem = std::copysign(0.0, b);
+  }
+  if (quot != 0) {
+    // a - rem is close to a multiple of b, so round rather than truncate.
+    auto floored = std::floor(quot);
+    if (quot - floored > 0.5) floored += 1.0;
+    quot = floored;
+  } else {
+    quot = std::copysign(0.0, a / b);
+  }
 }
 
-template <class T1, class T2>
-auto mul(T1 const& a, T2 const& b) -> PyObj {
-  throw "Cannot mul two types";
+// An int or bool operand as an int.
+auto as_int(PyObj const& obj) -> PyInt const* {
+  if (auto b = mpark::get_if<PyBool>(&obj)) return b;
+  return mpark::get_if<PyInt>(&obj);
 }
 
-template <class T1, class T2>
-auto div(T1 const& a, T2 const& b) -> PyObj {
-  throw "Cannot div two types";
+auto is_negative(PyInt const& i) -> bool {
+  return i.big ? i.big->negative : i.value < 0;
+}
+
+// x mod m with the sign of m.
+auto floor_mod(__int128 x, long m) -> __int128 {
+  auto rem = x % m;
+  if (rem != 0 && (rem < 0) != (m < 0)) rem += m;
+  return rem;
+}
+
+// The inverse of a modulo m in [0, |m|), by the extended Euclidean algorithm.
+auto inverse_mod(long a, long m) -> __int128 {
+  __int128 n = m < 0 ? -static_cast<__int128>(m) : m;
+  __int128 r = a % n < 0 ? a % n + n : a % n;
+  __int128 next_r = n;
+  __int128 s = 1;
+  __int128 next_s = 0;
+  while (next_r != 0) {
+    auto q = r / next_r;
+    r -= q * next_r;
+    std::swap(r, next_r);
+    s -= q * next_s;
+    std::swap(s, next_s);
+  }
+  if (r != 1) throw "base is not invertible for the given modulus";
+  return s < 0 ? s + n : s;
+}
+
+// Converts index to a position in a sequence of the given size.
+auto position(PyObj const& index, std::size_t size) -> std::size_t {
+  auto i = as_int(index);
+  if (i == nullptr) throw "Indices must be integers";
+  if (i->big) throw "Index out of range";
+  auto pos = i->value < 0 ? i->value + static_cast<long>(size) : i->value;
+  if (pos < 0 || pos >= static_cast<long>(size)) throw "Index out of range";
+  return pos;
+}
+
+// Calls each with every value of iterable in turn.
+template <class F>
+void for_each(std::shared_ptr<PyObj> const& iterable, Stack& stack, F each) {
+  if (auto range = mpark::get_if<PyRange>(iterable.get())) {
+    auto value = range->start;
+    for (auto n = length(*range); n > 0; --n) {
+      each(std::make_shared<PyObj>(PyInt(value)));
+      // Stepping past the last value could overflow.
+      if (n > 1) value += range->step;
+    }
+  } else if (auto list = mpark::get_if<PyList>(iterable.get())) {
+    // The body may append, so the size is checked every time.
+    for (std::size_t i = 0; i < list->values.size(); ++i) {
+      each(list->values[i]);
+    }
+  } else if (auto dict = mpark::get_if<PyDict>(iterable.get())) {
+    for (std::size_t i = 0; i < dict->size(); ++i) {
+      each(dict->entries()[i].key);
+    }
+  } else if (auto tuple = mpark::get_if<PyTuple>(iterable.get())) {
+    for (auto&& value : *tuple) each(value);
+  } else if (auto str = mpark::get_if<PyStr>(iterable.get())) {
+    for (std::size_t i = 0, end = 0; i < str->size(); i = end) {
+      end = str->next(i);
+      each(std::make_shared<PyObj>(PyStr(str->data() + i, end - i)));
+    }
+  } else if (auto gen = mpark::get_if<PyGenerator>(iterable.get())) {
+    auto state = gen->state;
+    while (auto value = try_resume(state, stack)) each(std::move(value));
+  } else {
+    throw "Object is not iterable";
+  }
+}
+
+// Compares two sequences lexicographically.
+auto compare_elements(std::shared_ptr<PyObj> const* a, std::size_t m,
+                      std::shared_ptr<PyObj> const* b, std::size_t n) -> int {
+  for (std::size_t i = 0; i < std::min(m, n); ++i) {
+    if (a[i] == b[i]) continue;
+    if (auto result = cmp(*a[i], *b[i])) return result;
+  }
+  return (m > n) - (m < n);
+}
+
+auto builtin_len(std::vector<std::shared_ptr<PyObj>> const& args,
+                 Stack& stack) -> std::shared_ptr<PyObj> {
+  if (args.size() != 1) throw "Wrong number of arguments";
+  return std::make_shared<PyObj>(
+      PyInt(static_cast<long>(length(*args.front()))));
+}
+
+auto builtin_next(std::vector<std::shared_ptr<PyObj>> const& args,
+                  Stack& stack) -> std::shared_ptr<PyObj> {
+  if (args.size() != 1) throw "Wrong number of arguments";
+  auto gen = mpark::get_if<PyGenerator>(args.front().get());
+  if (gen == nullptr) throw "Object is not an iterator";
+  return resume(gen->state, stack);
+}
+
+auto builtin_range(std::vector<std::shared_ptr<PyObj>> const& args,
+                   Stack& stack) -> std::shared_ptr<PyObj> {
+  if (args.empty() || args.size() > 3) throw "Wrong number of arguments";
+  long bounds[3] = {0, 0, 1};
+  for (int i = 0; i < args.size(); ++i) {
+    auto bound = as_int(*args[i]);
+    if (bound == nullptr) throw "range() arguments must be ints";
+    if (bound->big) throw "range() arguments must fit in a machine word";
+    // range(stop) starts from zero.
+    bounds[args.size() == 1 ? 1 : i] = bound->value;
+  }
+  if (bounds[2] == 0) throw "range() arg 3 must not be zero";
+
+  PyRange range;
+  range.start = bounds[0];
+  range.stop = bounds[1];
+  range.step = bounds[2];
+  return std::make_shared<PyObj>(range);
+}
+
+auto builtin_pow(std::vector<std::shared_ptr<PyObj>> const& args,
+                 Stack& stack) -> std::shared_ptr<PyObj> {
+  if (args.size() == 2) return std::make_shared<PyObj>(pow(*args[0], *args[1]));
+  if (args.size() == 3) {
+    return std::make_shared<PyObj>(pow_mod(*args[0], *args[1], *args[2]));
+  }
+  throw "Wrong number of arguments";
+}
+
+auto make_builtin(std::string const& name, BuiltinFn fun)
+    -> std::shared_ptr<PyObj> {
+  PyBuiltin builtin;
+  builtin.name = name;
+  builtin.fun = fun;
+  return std::make_shared<PyObj>(builtin);
 }
 }  // namespace
 
-auto eval_expr(Expression const& expr, Stack const& stack)
+auto builtins() -> BindingMap const& {
+  static BindingMap const table = {
+      {"len", make_builtin("len", builtin_len)},
+      {"next", make_builtin("next", builtin_next)},
+      {"pow", make_builtin("pow", builtin_pow)},
+      {"range", make_builtin("range", builtin_range)},
+  };
+  return table;
+}
+
+auto lookup_global(std::string const& name, Stack const& stack)
     -> std::shared_ptr<PyObj> {
+  auto global = stack.globals.find(name);
+  if (global != stack.globals.end()) return global->second;
+  return builtins().at(name);
+}
+
+auto eval_expr(Expression const& expr, Stack& stack) -> std::shared_ptr<PyObj> {
   auto visitor = [&](auto&& expr) { return eval_expr(expr, stack); };
   return mpark::visit(visitor, expr);
 }
 
-auto eval_expr(BoolOp const& expr, Stack const& stack)
-    -> std::shared_ptr<PyObj> {
-  PyObj left_term = *eval_expr(*expr.left);
-  PyObj right_term = *eval_expr(*expr.right);
-
-  PyObj result;
+auto eval_expr(BoolOp const& expr, Stack& stack) -> std::shared_ptr<PyObj> {
+  auto left = eval_expr(*expr.left, stack);
+  // The right operand is only evaluated when the left does not decide the
+  // result, and whichever operand decides is returned as it is.
   switch (expr.op) {
     case BoolOperator::and_op:
-      result = truth_value(left_term) && truth_value(right_term);
+      if (!truth_value(*left)) return left;
       break;
     case BoolOperator::or_op:
-      result = truth_value(left_term) || truth_value(right_term);
+      if (truth_value(*left)) return left;
       break;
     default:
       throw "Invalid bool operator";
       break;
   }
-  return std::make_shared<PyObj>(result);
+  return eval_expr(*expr.right, stack);
 }
 
-auto eval_expr(BinOp const& expr, Stack const& stack)
-    -> std::shared_ptr<PyObj> {
-  // enum class Op {
-  //   add,
-  //   sub,
-  //   mult,
-  //   mat_mult,
-  //   div,
-  //   mod,
-  //   pow,
-  //   lshift,
-  //   rshift,
-  //   bit_or,
-  //   bit_xor,
-  //   bit_and,
-  //   floor_div
-  // };
-
-  PyObj left_eval = *eval_expr(*expr.left, stack);
-  PyObj right_eval = *eval_expr(*expr.right, stack);
+auto eval_expr(BinOp const& expr, Stack& stack) -> std::shared_ptr<PyObj> {
+  auto left = eval_expr(*expr.left, stack);
+  auto right = eval_expr(*expr.right, stack);
+  return binary_op(expr.op, std::move(left), *right);
+}
 
-  PyObj result;
-  switch (expr.op) {
-    case Op::add:
-      result = add(left_eval, right_eval);
-      break;
-    case Op::sub:
-      result = sub(left_eval, right_eval);
-      break;
-    case Op::mul:
-      result = mul(left_eval, right_eval);
-      break;
-    case Op::div:
-      result = div(left_eval, right_eval);
-      break;
-    default:
-      throw "BinOp not yet implemented";
-      break;
+auto eval_expr(Call const& expr, Stack& stack) -> std::shared_ptr<PyObj> {
+  if (auto method = mpark::get_if<Attribute>(expr.func.get())) {
+    auto self = eval_expr(*method->value, stack);
+    std::vector<std::shared_ptr<PyObj>> args;
+    for (auto&& arg : expr.args) args.push_back(eval_expr(arg, stack));
+    return call_method(self, method->attr, args);
   }
-  return std::make_shared<PyObj>(result);
+
+  auto callee = eval_expr(*expr.func, stack);
+  if (auto builtin = mpark::get_if<PyBuiltin>(callee.get())) {
+    std::vector<std::shared_ptr<PyObj>> args;
+    for (auto&& arg : expr.args) args.push_back(eval_expr(arg, stack));
+    return builtin->fun(args, stack);
+  }
+
+  auto fun = mpark::get_if<PyFunction>(callee.get());
+  if (fun == nullptr) throw "Object is not callable";
+  if (fun->def.args.size() != expr.args.size())
+    throw "Wrong number of arguments";
+
+  // Generator bodies run on the VM, whose frames can be suspended.
+  if (fun->scope->generator) {
+    std::vector<std::shared_ptr<PyObj>> args;
+    for (auto&& arg : expr.args) args.push_back(eval_expr(arg, stack));
+    PyGenerator gen;
+    gen.state = make_generator(*fun, args);
+    return std::make_shared<PyObj>(gen);
+  }
+
+  BindingMap locals;
+  CellMap cells;
+  enter_closure(*fun, locals, cells);
+  for (int i = 0; i < expr.args.size(); ++i) {
+    bind_local(fun->def.args[i], eval_expr(expr.args[i], stack), locals, cells);
+  }
+
+  CallFrame frame(stack, fun->def.name, std::move(locals), std::move(cells));
+  try {
+    for (auto&& body_stmt : fun->def.body) {
+      eval_stmt(body_stmt, stack);
+    }
+  } catch (EarlyReturn& er) {
+    return er.result;
+  }
+  return std::make_shared<PyObj>(PyNoneType());
 }
 
-auto eval_expr(Compare const& expr, Stack const& stack)
-    -> std::shared_ptr<PyObj> {
+auto eval_expr(Compare const& expr, Stack& stack) -> std::shared_ptr<PyObj> {
   if (expr.ops.size() != expr.comparators.size())
     throw "Not enough ops/comparators";
 
-  auto result = *eval_expr(*expr.left, stack);
+  // `a < b < c` is `a < b and b < c` with b evaluated once, so the chain
+  // stops at its first false link. Operands are compared where they live, so
+  // that `is` sees identity.
+  auto left = eval_expr(*expr.left, stack);
+  if (expr.ops.empty()) return left;
   for (int i = 0; i < expr.ops.size(); ++i) {
-    auto op = expr.ops[i];
-    auto cmp_term = *eval_expr(expr.comparators[i], stack);
-
-    switch (op) {
-      case CmpOp::eq:
-        result = cmp(result, cmp_term) == 0;
-        break;
-      case CmpOp::eq_not:
-        result = cmp(result, cmp_term) != 0;
-        break;
-      case CmpOp::lt:
-        result = cmp(result, cmp_term) < 0;
-        break;
-      case CmpOp::lt_eq:
-        result = cmp(result, cmp_term) <= 0;
-        break;
-      case CmpOp::gt:
-        result = cmp(result, cmp_term) > 0;
-        break;
-      case CmpOp::gt_eq:
-        result = cmp(result, cmp_term) >= 0;
-        break;
-      default:
-        throw "Compare not yet implemented";
-        break;
-    }
+    auto right = eval_expr(expr.comparators[i], stack);
+    if (!compare_op(expr.ops[i], *left, *right)) return py_bool(false);
+    left = std::move(right);
   }
-
-  return std::make_shared<PyObj>(result);
+  return py_bool(true);
 }
 
-auto eval_expr(Num const& expr, Stack const& stack) -> std::shared_ptr<PyObj> {
+auto eval_expr(Num const& expr, Stack& stack) -> std::shared_ptr<PyObj> {
   return std::make_shared<PyObj>(expr.n);
 }
 
-auto eval_expr(Str const& expr, Stack const& stack) -> std::shared_ptr<PyObj> {
-  return std::make_shared<PyObj>(expr.s);
+auto eval_expr(Str const& expr, Stack& stack) -> std::shared_ptr<PyObj> {
+  return std::make_shared<PyObj>(literal_str(expr.s));
 }
 
-auto eval_expr(Name const& expr, Stack const& stack) -> std::shared_ptr<PyObj> {
+auto eval_expr(Name const& expr, Stack& stack) -> std::shared_ptr<PyObj> {
   // TODO: FIX THIS
   // We should be throwing a Python exception here.
 
-  if (stack.call_stack.empty()) {
-    return stack.globals.at(expr.id);
-  } else {
-    if (stack.locals.count(expr.id) > 0) {
-      return stack.locals.at(expr.id);
-    } else {
-      return stack.globals.at(expr.id);
-    }
+  if (!stack.call_stack.empty()) {
+    auto value = lookup_local(expr.id, stack.locals, stack.cells);
+    if (value) return value;
   }
+  return lookup_global(expr.id, stack);
 }
 
-auto eval_expr(NameConstant const& expr, Stack const& stack)
+auto eval_expr(NameConstant const& expr, Stack& stack)
     -> std::shared_ptr<PyObj> {
   PyObj result;
   switch (expr.value) {
@@ -195,6 +620,74 @@ auto eval_expr(NameConstant const& expr, Stack const& stack)
   return std::make_shared<PyObj>(result);
 }
 
+auto eval_expr(Yield const& expr, Stack& stack) -> std::shared_ptr<PyObj> {
+  // Functions containing yield never run in the tree-walker.
+  throw "'yield' outside function";
+}
+
+auto eval_expr(Attribute const& expr, Stack& stack) -> std::shared_ptr<PyObj> {
+  throw "Not yet implemented";
+}
+
+auto eval_expr(List const& expr, Stack& stack) -> std::shared_ptr<PyObj> {
+  PyList list;
+  list.values.reserve(expr.elts.size());
+  for (auto&& elt : expr.elts) list.values.push_back(eval_expr(elt, stack));
+  return std::make_shared<PyObj>(std::move(list));
+}
+
+auto eval_expr(ListComp const& expr, Stack& stack) -> std::shared_ptr<PyObj> {
+  auto result = std::make_shared<PyObj>(PyList());
+  auto& values = mpark::get<PyList>(*result).values;
+  auto iterable = eval_expr(*expr.iter, stack);
+  // Unless some values are filtered out, the result is as long as the source.
+  if (expr.ifs.empty()) {
+    auto range = mpark::get_if<PyRange>(iterable.get());
+    auto list = mpark::get_if<PyList>(iterable.get());
+    if (range != nullptr) values.reserve(length(*range));
+    if (list != nullptr) values.reserve(list->values.size());
+  }
+
+  for_each(iterable, stack, [&](std::shared_ptr<PyObj> value) {
+    assign_target(*expr.target, std::move(value), stack);
+    for (auto&& test : expr.ifs) {
+      if (!truth_value(*eval_expr(test, stack))) return;
+    }
+    values.push_back(eval_expr(*expr.elt, stack));
+  });
+  return result;
+}
+
+auto eval_expr(Dict const& expr, Stack& stack) -> std::shared_ptr<PyObj> {
+  if (expr.keys.size() != expr.values.size()) throw "Not enough keys/values";
+  auto result = std::make_shared<PyObj>(PyDict());
+  auto& dict = mpark::get<PyDict>(*result);
+  for (int i = 0; i < expr.keys.size(); ++i) {
+    auto key = eval_expr(expr.keys[i], stack);
+    dict.set(std::move(key), eval_expr(expr.values[i], stack));
+  }
+  return result;
+}
+
+auto eval_expr(Tuple const& expr, Stack& stack) -> std::shared_ptr<PyObj> {
+  std::shared_ptr<PyObj> values[PyTuple::max_pooled];
+  if (expr.elts.size() <= PyTuple::max_pooled) {
+    for (std::size_t i = 0; i < expr.elts.size(); ++i) {
+      values[i] = eval_expr(expr.elts[i], stack);
+    }
+    return std::make_shared<PyObj>(PyTuple(values, expr.elts.size()));
+  }
+  std::vector<std::shared_ptr<PyObj>> many;
+  for (auto&& elt : expr.elts) many.push_back(eval_expr(elt, stack));
+  return std::make_shared<PyObj>(PyTuple(many.data(), many.size()));
+}
+
+auto eval_expr(Subscript const& expr, Stack& stack) -> std::shared_ptr<PyObj> {
+  auto value = eval_expr(*expr.value, stack);
+  auto index = eval_expr(*expr.index, stack);
+  return subscript(*value, *index);
+}
+
 void eval_stmt(Statement const& stmt, Stack& stack) {
   auto visitor = [&](auto&& stmt) { return eval_stmt(stmt, stack); };
   return mpark::visit(visitor, stmt);
@@ -203,37 +696,81 @@ void eval_stmt(Statement const& stmt, Stack& stack) {
 void eval_stmt(FunctionDef const& stmt, Stack& stack) {
   PyFunction fun;
   fun.def = stmt;
+  fun.scope = std::make_shared<Scope const>(resolve_scope(stmt));
 
   if (stack.call_stack.empty()) {
     stack.globals[stmt.name] = std::make_shared<PyObj>(fun);
   } else {
-    stack.locals[stmt.name] = std::make_shared<PyObj>(fun);
+    capture(fun, stack.locals, stack.cells);
+    bind_local(stmt.name, std::make_shared<PyObj>(fun), stack.locals,
+               stack.cells);
   }
 }
 
 void eval_stmt(Return const& stmt, Stack& stack) {
   EarlyReturn er;
-  er.result = eval_expr(*stmt.value, stack);
+  // A bare `return` returns None.
+  er.result = stmt.value ? eval_expr(*stmt.value, stack)
+                         : std::make_shared<PyObj>(PyNoneType());
   throw er;
 }
 
 void eval_stmt(Assign const& stmt, Stack& stack) {
+  if (stmt.targets.empty()) throw "Assignment without a target";
+
+  // `a, b = b, a` stores the values as they are, without building a tuple.
+  auto values = mpark::get_if<Tuple>(stmt.value.get());
+  auto targets = stmt.targets.size() == 1
+                     ? mpark::get_if<Tuple>(&stmt.targets.front())
+                     : nullptr;
+  if (values != nullptr && targets != nullptr &&
+      values->elts.size() == targets->elts.size()) {
+    std::vector<std::shared_ptr<PyObj>> results;
+    results.reserve(values->elts.size());
+    for (auto&& elt : values->elts) results.push_back(eval_expr(elt, stack));
+    for (std::size_t i = 0; i < results.size(); ++i) {
+      assign_target(targets->elts[i], std::move(results[i]), stack);
+    }
+    return;
+  }
+
+  // `a = b = x` binds every target to the same object, left to right.
   auto result = eval_expr(*stmt.value, stack);
+  for (std::size_t i = 0; i + 1 < stmt.targets.size(); ++i) {
+    assign_target(stmt.targets[i], result, stack);
+  }
+  assign_target(stmt.targets.back(), std::move(result), stack);
+}
 
-  if (stmt.targets.size() == 1) {
-    auto visitor = Util::make_visitor(
-        [&](Name const& name) {
-          if (stack.call_stack.empty()) {
-            stack.globals[name.id] = result;
-          } else {
-            stack.locals[name.id] = result;
-          }
-        },
-        [](auto other) { throw "Not yet implemented"; });
-
-    mpark::visit(visitor, stmt.targets.front());
+void eval_stmt(AugAssign const& stmt, Stack& stack) {
+  if (auto name = mpark::get_if<Name>(stmt.target.get())) {
+    auto value = eval_expr(*stmt.value, stack);
+    // The binding itself is updated, so that a value nothing else holds can
+    // change in place.
+    std::shared_ptr<PyObj>* binding = nullptr;
+    if (stack.call_stack.empty()) {
+      auto global = stack.globals.find(name->id);
+      if (global != stack.globals.end()) binding = &global->second;
+    } else {
+      auto local = stack.locals.find(name->id);
+      auto cell = stack.cells.find(name->id);
+      if (local != stack.locals.end()) {
+        binding = &local->second;
+      } else if (cell != stack.cells.end()) {
+        binding = &cell->second->value;
+      }
+    }
+    if (binding == nullptr || !*binding) {
+      throw "Name referenced before assignment";
+    }
+    inplace_op(stmt.op, *binding, *value);
+  } else if (auto sub = mpark::get_if<Subscript>(stmt.target.get())) {
+    auto container = eval_expr(*sub->value, stack);
+    auto index = eval_expr(*sub->index, stack);
+    auto value = eval_expr(*stmt.value, stack);
+    inplace_subscript(stmt.op, *container, *index, *value);
   } else {
-    throw "Not yet implemented";
+    throw "Illegal expression for augmented assignment";
   }
 }
 
@@ -257,15 +794,31 @@ void eval_stmt(Expr const& stmt, Stack& stack) {
 void eval_stmt(Print const& stmt, Stack& stack) {
   bool first = true;
   for (auto&& obj : stmt.objects) {
-    auto result = *eval_expr(obj);
+    auto result = eval_expr(obj, stack);
     if (first) {
       first = false;
-      (*stmt.file) << str(result).value;
     } else {
-      (*stmt.file) << " " << str(result).value;
+      stmt.file->put(' ');
     }
+    print(*stmt.file, *result);
+  }
+  stmt.file->put('\n');
+}
+
+void eval_stmt(While const& stmt, Stack& stack) {
+  while (truth_value(*eval_expr(*stmt.test, stack))) {
+    for (auto&& body_stmt : stmt.body) eval_stmt(body_stmt, stack);
   }
-  (*stmt.file) << "\n";
+  for (auto&& body_stmt : stmt.or_else) eval_stmt(body_stmt, stack);
+}
+
+void eval_stmt(For const& stmt, Stack& stack) {
+  auto iterable = eval_expr(*stmt.iter, stack);
+  for_each(iterable, stack, [&](std::shared_ptr<PyObj> value) {
+    assign_target(*stmt.target, std::move(value), stack);
+    for (auto&& body_stmt : stmt.body) eval_stmt(body_stmt, stack);
+  });
+  for (auto&& body_stmt : stmt.or_else) eval_stmt(body_stmt, stack);
 }
 
 void eval_ast(Module const& ast, Stack& stack) {
@@ -275,24 +828,214 @@ void eval_ast(Module const& ast, Stack& stack) {
 }
 
 auto add(PyObj const& a, PyObj const& b) -> PyObj {
-  auto visitor = [](auto&& a, auto&& b) { return add(a, b); };
-  return mpark::visit(visitor, a, b);
+  return binary_op(Op::add, a, b);
 }
 
 auto add(PyInt const& a, PyInt const& b) -> PyObj {
-  return PyInt(a.value + b.value);
+  long result = 0;
+  if (!a.big && !b.big &&
+      !__builtin_add_overflow(a.value, b.value, &result)) {
+    return PyInt(result);
+  }
+  return make_int(add(make_bigint(a), make_bigint(b)));
+}
+auto add(PyFloat const& a, PyFloat const& b) -> PyObj {
+  return PyFloat(a.value + b.value);
 }
 auto add(PyStr const& a, PyStr const& b) -> PyObj {
-  return PyStr(a.value + b.value);
+  auto result = a;
+  result.append(b);
+  return result;
+}
+
+auto add(PyList const& a, PyList const& b) -> PyObj {
+  PyList result;
+  result.values.reserve(a.values.size() + b.values.size());
+  result.values.insert(result.values.end(), a.values.begin(), a.values.end());
+  result.values.insert(result.values.end(), b.values.begin(), b.values.end());
+  return result;
+}
+
+auto add(PyTuple const& a, PyTuple const& b) -> PyObj {
+  std::vector<std::shared_ptr<PyObj>> values(a.begin(), a.end());
+  values.insert(values.end(), b.begin(), b.end());
+  return PyTuple(values.data(), values.size());
+}
+
+auto binary_op(Op op, PyObj const& a, PyObj const& b) -> PyObj {
+  auto index = static_cast<int>(op);
+  auto fn = binary_table[index][a.index()][b.index()];
+  if (fn == nullptr) throw binary_errors[index];
+  return fn(a, b);
+}
+
+auto binary_op(Op op, std::shared_ptr<PyObj> a, PyObj const& b)
+    -> std::shared_ptr<PyObj> {
+  if (op == Op::add && a.use_count() == 1) {
+    auto s = mpark::get_if<PyStr>(a.get());
+    auto t = mpark::get_if<PyStr>(&b);
+    if (s != nullptr && t != nullptr) {
+      s->append(*t);
+      return a;
+    }
+  }
+  return std::make_shared<PyObj>(binary_op(op, *a, b));
+}
+
+void inplace_op(Op op, std::shared_ptr<PyObj>& target, PyObj const& b) {
+  if (auto l = mpark::get_if<PyList>(target.get())) {
+    if (op == Op::add) {
+      // Copied first, as b may be the list itself.
+      std::vector<std::shared_ptr<PyObj>> values;
+      if (auto m = mpark::get_if<PyList>(&b)) {
+        values = m->values;
+      } else if (auto t = mpark::get_if<PyTuple>(&b)) {
+        values.assign(t->begin(), t->end());
+      } else {
+        throw "Can only extend a list by a list or tuple";
+      }
+      l->values.insert(l->values.end(), values.begin(), values.end());
+      return;
+    }
+  }
+
+  if (target.use_count() == 1) {
+    auto i = mpark::get_if<PyInt>(target.get());
+    auto j = mpark::get_if<PyInt>(&b);
+    if (i != nullptr && j != nullptr && !i->big && !j->big) {
+      long result = 0;
+      bool overflow = true;
+      switch (op) {
+        case Op::add:
+          overflow = __builtin_add_overflow(i->value, j->value, &result);
+          break;
+        case Op::sub:
+          overflow = __builtin_sub_overflow(i->value, j->value, &result);
+          break;
+        case Op::mul:
+          overflow = __builtin_mul_overflow(i->value, j->value, &result);
+          break;
+        default:
+          break;
+      }
+      if (!overflow) {
+        i->value = result;
+        return;
+      }
+    }
+
+    auto f = mpark::get_if<PyFloat>(target.get());
+    auto g = mpark::get_if<PyFloat>(&b);
+    if (f != nullptr && g != nullptr &&
+        (op == Op::add || op == Op::sub || op == Op::mul)) {
+      if (op == Op::add) f->value += g->value;
+      if (op == Op::sub) f->value -= g->value;
+      if (op == Op::mul) f->value *= g->value;
+      return;
+    }
+
+    auto s = mpark::get_if<PyStr>(target.get());
+    auto t = mpark::get_if<PyStr>(&b);
+    if (s != nullptr && t != nullptr && op == Op::add) {
+      s->append(*t);
+      return;
+    }
+  }
+
+  // target keeps its value if the operator throws.
+  target = std::make_shared<PyObj>(binary_op(op, *target, b));
+}
+
+void inplace_subscript(Op op, PyObj& value, PyObj const& index,
+                       PyObj const& b) {
+  if (auto l = mpark::get_if<PyList>(&value)) {
+    inplace_op(op, l->values[position(index, l->values.size())], b);
+    return;
+  }
+  if (auto d = mpark::get_if<PyDict>(&value)) {
+    auto item = d->lookup(index);
+    if (item == nullptr) throw "KeyError";
+    inplace_op(op, *item, b);
+    return;
+  }
+  subscript(value, index);
+  throw "Object does not support item assignment";
+}
+
+auto call_method(std::shared_ptr<PyObj> const& self, std::string const& name,
+                 std::vector<std::shared_ptr<PyObj>> const& args)
+    -> std::shared_ptr<PyObj> {
+  auto list = mpark::get_if<PyList>(self.get());
+  if (list != nullptr && name == "append") {
+    if (args.size() != 1) throw "Wrong number of arguments";
+    list->values.push_back(args.front());
+    return std::make_shared<PyObj>();
+  }
+  auto dict = mpark::get_if<PyDict>(self.get());
+  if (dict != nullptr && name == "get") {
+    if (args.empty() || args.size() > 2) throw "Wrong number of arguments";
+    auto value = dict->get(*args.front());
+    if (value) return value;
+    return args.size() == 2 ? args.back() : std::make_shared<PyObj>();
+  }
+  throw "Object has no such attribute";
+}
+
+auto bit_and(PyObj const& a, PyObj const& b) -> PyObj {
+  return binary_op(Op::bit_and, a, b);
+}
+
+auto bit_and(PyInt const& a, PyInt const& b) -> PyObj {
+  if (!a.big && !b.big) return PyInt(a.value & b.value);
+  return make_int(bit_and(make_bigint(a), make_bigint(b)));
+}
+
+auto bit_and(PyBool const& a, PyBool const& b) -> PyObj {
+  PyBool result;
+  result.value = (a.value != 0) && (b.value != 0);
+  return result;
+}
+
+auto bit_or(PyObj const& a, PyObj const& b) -> PyObj {
+  return binary_op(Op::bit_or, a, b);
+}
+
+auto bit_or(PyInt const& a, PyInt const& b) -> PyObj {
+  if (!a.big && !b.big) return PyInt(a.value | b.value);
+  return make_int(bit_or(make_bigint(a), make_bigint(b)));
+}
+
+auto bit_or(PyBool const& a, PyBool const& b) -> PyObj {
+  PyBool result;
+  result.value = (a.value != 0) || (b.value != 0);
+  return result;
+}
+
+auto bit_xor(PyObj const& a, PyObj const& b) -> PyObj {
+  return binary_op(Op::bit_xor, a, b);
+}
+
+auto bit_xor(PyInt const& a, PyInt const& b) -> PyObj {
+  if (!a.big && !b.big) return PyInt(a.value ^ b.value);
+  return make_int(bit_xor(make_bigint(a), make_bigint(b)));
+}
+
+auto bit_xor(PyBool const& a, PyBool const& b) -> PyObj {
+  PyBool result;
+  result.value = (a.value != 0) != (b.value != 0);
+  return result;
 }
 
 auto cmp(PyObj const& a, PyObj const& b) -> int {
-  auto visitor = [](auto&& a, auto&& b) { return cmp(a, b); };
-  return mpark::visit(visitor, a, b);
+  auto fn = compare_table[a.index()][b.index()];
+  if (fn == nullptr) throw "Error comparing two types";
+  return fn(a, b);
 }
 
 auto cmp(PyInt const& a, PyInt const& b) -> int {
-  if (a.value < b.value)
+  if (a.big || b.big)
+    return cmp(make_bigint(a), make_bigint(b));
+  else if (a.value < b.value)
     return -1;
   else if (a.value > b.value)
     return 1;
@@ -300,53 +1043,539 @@ auto cmp(PyInt const& a, PyInt const& b) -> int {
     return 0;
 }
 
+auto cmp(PyList const& a, PyList const& b) -> int {
+  return compare_elements(a.values.data(), a.values.size(), b.values.data(),
+                          b.values.size());
+}
+
+auto cmp(PyTuple const& a, PyTuple const& b) -> int {
+  return compare_elements(a.begin(), a.size(), b.begin(), b.size());
+}
+
 auto cmp(PyStr const& a, PyStr const& b) -> int {
-  return a.value.compare(b.value);
+  if (a.same_buffer(b)) return 0;
+  auto n = std::min(a.size(), b.size());
+  if (auto result = std::memcmp(a.data(), b.data(), n)) return result;
+  return (a.size() > b.size()) - (a.size() < b.size());
+}
+
+auto cmp(PyFloat const& a, PyFloat const& b) -> int {
+  return (a.value > b.value) - (a.value < b.value);
+}
+
+auto cmp(PyInt const& a, PyFloat const& b) -> int {
+  // Ints of up to 53 bits convert to double exactly.
+  auto const exact = 1L << 53;
+  if (!a.big && a.value >= -exact && a.value <= exact) {
+    return cmp(to_float(a), b);
+  }
+  if (std::isnan(b.value)) return 0;
+  if (std::isinf(b.value)) return b.value > 0 ? -1 : 1;
+
+  // Compare with the integer part, then let any fraction break a tie.
+  auto whole = std::floor(b.value);
+  auto result = cmp(make_bigint(a), truncate_to_bigint(whole));
+  if (result != 0) return result;
+  return b.value > whole ? -1 : 0;
+}
+
+auto cmp(PyFloat const& a, PyInt const& b) -> int { return -cmp(b, a); }
+
+auto compare_op(CmpOp op, PyObj const& a, PyObj const& b) -> bool {
+  switch (op) {
+    case CmpOp::is:
+      return identical(a, b);
+    case CmpOp::is_not:
+      return !identical(a, b);
+    case CmpOp::in:
+      return contains(b, a);
+    case CmpOp::not_in:
+      return !contains(b, a);
+    default:
+      break;
+  }
+
+  // NaN is unordered with everything, itself included.
+  if (is_nan(a) || is_nan(b)) return op == CmpOp::eq_not;
+
+  auto s = mpark::get_if<PyStr>(&a);
+  auto t = mpark::get_if<PyStr>(&b);
+  if (s != nullptr && t != nullptr &&
+      (op == CmpOp::eq || op == CmpOp::eq_not)) {
+    return equal(*s, *t) == (op == CmpOp::eq);
+  }
+
+  switch (op) {
+    case CmpOp::eq:
+      return cmp(a, b) == 0;
+    case CmpOp::eq_not:
+      return cmp(a, b) != 0;
+    case CmpOp::lt:
+      return cmp(a, b) < 0;
+    case CmpOp::lt_eq:
+      return cmp(a, b) <= 0;
+    case CmpOp::gt:
+      return cmp(a, b) > 0;
+    case CmpOp::gt_eq:
+      return cmp(a, b) >= 0;
+    default:
+      throw "Compare not yet implemented";
+      break;
+  }
+}
+
+auto py_bool(bool value) -> std::shared_ptr<PyObj> {
+  static auto const true_value = [] {
+    PyBool b;
+    b.value = true;
+    return std::make_shared<PyObj>(b);
+  }();
+  static auto const false_value = std::make_shared<PyObj>(PyBool());
+  return value ? true_value : false_value;
+}
+
+auto equal(PyObj const& a, PyObj const& b) -> bool {
+  if (compare_table[a.index()][b.index()] == nullptr) return false;
+  return compare_op(CmpOp::eq, a, b);
+}
+
+auto contains(PyObj const& container, PyObj const& item) -> bool {
+  if (auto s = mpark::get_if<PyStr>(&container)) {
+    auto t = mpark::get_if<PyStr>(&item);
+    if (t == nullptr) throw "'in <string>' requires string as left operand";
+    return contains(*s, *t);
+  }
+  if (auto r = mpark::get_if<PyRange>(&container)) {
+    auto i = as_int(item);
+    return i != nullptr && contains(*r, *i);
+  }
+  if (auto l = mpark::get_if<PyList>(&container)) return contains(*l, item);
+  if (auto d = mpark::get_if<PyDict>(&container)) return contains(*d, item);
+  if (auto t = mpark::get_if<PyTuple>(&container)) return contains(*t, item);
+  throw "Argument is not iterable";
+}
+
+auto contains(PyStr const& s, PyStr const& sub) -> bool {
+  return find(s.data(), s.size(), sub.data(), sub.size()) != not_found;
+}
+
+auto contains(PyRange const& r, PyInt const& i) -> bool {
+  if (i.big) return false;
+  // Offsets are taken in unsigned arithmetic, which cannot overflow.
+  if (r.step > 0) {
+    if (i.value < r.start || i.value >= r.stop) return false;
+    auto offset = static_cast<unsigned long>(i.value) - r.start;
+    return offset % r.step == 0;
+  }
+  if (i.value > r.start || i.value <= r.stop) return false;
+  auto offset = static_cast<unsigned long>(r.start) - i.value;
+  return offset % (0 - static_cast<unsigned long>(r.step)) == 0;
+}
+
+auto contains(PyList const& l, PyObj const& item) -> bool {
+  for (auto&& value : l.values) {
+    if (identical(*value, item) || equal(*value, item)) return true;
+  }
+  return false;
+}
+
+auto contains(PyTuple const& t, PyObj const& item) -> bool {
+  for (auto&& value : t) {
+    if (identical(*value, item) || equal(*value, item)) return true;
+  }
+  return false;
+}
+
+auto contains(PyDict const& d, PyObj const& key) -> bool {
+  return d.get(key) != nullptr;
+}
+
+auto length(PyObj const& obj) -> unsigned long {
+  if (auto s = mpark::get_if<PyStr>(&obj)) {
+    return s->length();
+  }
+  if (auto r = mpark::get_if<PyRange>(&obj)) return length(*r);
+  if (auto l = mpark::get_if<PyList>(&obj)) return l->values.size();
+  if (auto d = mpark::get_if<PyDict>(&obj)) return d->size();
+  if (auto t = mpark::get_if<PyTuple>(&obj)) return t->size();
+  throw "Object has no len()";
+}
+
+auto length(PyRange const& r) -> unsigned long {
+  if (r.step > 0 && r.start < r.stop) {
+    auto span = static_cast<unsigned long>(r.stop) - r.start;
+    return (span - 1) / r.step + 1;
+  }
+  if (r.step < 0 && r.start > r.stop) {
+    auto span = static_cast<unsigned long>(r.start) - r.stop;
+    return (span - 1) / (0 - static_cast<unsigned long>(r.step)) + 1;
+  }
+  return 0;
 }
 
 auto div(PyObj const& a, PyObj const& b) -> PyObj {
-  auto visitor = [](auto&& a, auto&& b) { return div(a, b); };
-  return mpark::visit(visitor, a, b);
+  return binary_op(Op::div, a, b);
 }
 
 auto div(PyInt const& a, PyInt const& b) -> PyObj {
-  return PyInt(a.value / b.value);
+  // Ints of up to 53 bits convert to double exactly, so one division rounds
+  // correctly.
+  auto const exact = 1L << 53;
+  if (!a.big && !b.big && a.value >= -exact && a.value <= exact &&
+      b.value >= -exact && b.value <= exact) {
+    if (b.value == 0) throw "Division by zero";
+    return PyFloat(static_cast<double>(a.value) / b.value);
+  }
+  return PyFloat(true_div(make_bigint(a), make_bigint(b)));
+}
+
+auto div(PyFloat const& a, PyFloat const& b) -> PyObj {
+  if (b.value == 0) throw "Division by zero";
+  return PyFloat(a.value / b.value);
+}
+
+auto floor_div(PyObj const& a, PyObj const& b) -> PyObj {
+  return binary_op(Op::floor_div, a, b);
+}
+
+auto floor_div(PyInt const& a, PyInt const& b) -> PyObj {
+  if (a.big || b.big) {
+    return make_int(floor_div(make_bigint(a), make_bigint(b)));
+  }
+  if (b.value == 0) throw "Division by zero";
+  // Only LONG_MIN // -1 overflows.
+  if (b.value == -1) return sub(PyInt(0), a);
+  // Truncation rounds up when the remainder and divisor differ in sign.
+  auto quot = a.value / b.value;
+  auto rem = a.value % b.value;
+  return PyInt(quot - ((rem != 0) & ((rem ^ b.value) < 0)));
+}
+
+auto floor_div(PyFloat const& a, PyFloat const& b) -> PyObj {
+  double quot = 0;
+  double rem = 0;
+  float_divmod(a.value, b.value, quot, rem);
+  return PyFloat(quot);
+}
+
+auto lshift(PyObj const& a, PyObj const& b) -> PyObj {
+  return binary_op(Op::lshift, a, b);
+}
+
+auto lshift(PyInt const& a, PyInt const& b) -> PyObj {
+  if (is_negative(b)) throw "Negative shift count";
+  if (!a.big && a.value == 0) return PyInt(0);
+  if (b.big) throw "Shift count too large";
+
+  auto count = static_cast<unsigned long>(b.value);
+  if (!a.big && count < std::numeric_limits<long>::digits) {
+    auto shifted =
+        static_cast<long>(static_cast<unsigned long>(a.value) << count);
+    if (shifted >> count == a.value) return PyInt(shifted);
+  }
+  return make_int(lshift(make_bigint(a), count));
+}
+
+auto mod(PyObj const& a, PyObj const& b) -> PyObj {
+  return binary_op(Op::mod, a, b);
+}
+
+auto mod(PyInt const& a, PyInt const& b) -> PyObj {
+  if (a.big || b.big) return make_int(mod(make_bigint(a), make_bigint(b)));
+  if (b.value == 0) throw "Division by zero";
+  if (b.value == -1) return PyInt(0);
+  // The remainder takes the divisor's sign.
+  auto rem = a.value % b.value;
+  return PyInt(rem + b.value * ((rem != 0) & ((rem ^ b.value) < 0)));
+}
+
+auto mod(PyFloat const& a, PyFloat const& b) -> PyObj {
+  double quot = 0;
+  double rem = 0;
+  float_divmod(a.value, b.value, quot, rem);
+  return PyFloat(rem);
 }
 
 auto mul(PyObj const& a, PyObj const& b) -> PyObj {
-  auto visitor = [](auto&& a, auto&& b) { return mul(a, b); };
-  return mpark::visit(visitor, a, b);
+  return binary_op(Op::mul, a, b);
 }
 
 auto mul(PyInt const& a, PyInt const& b) -> PyObj {
-  return PyInt(a.value * b.value);
+  long result = 0;
+  if (!a.big && !b.big &&
+      !__builtin_mul_overflow(a.value, b.value, &result)) {
+    return PyInt(result);
+  }
+  return make_int(mul(make_bigint(a), make_bigint(b)));
+}
+
+auto mul(PyFloat const& a, PyFloat const& b) -> PyObj {
+  return PyFloat(a.value * b.value);
 }
 
 auto mul(PyStr const& a, PyInt const& b) -> PyObj {
-  PyStr result;
-  for (int i = 0; i < b.value; ++i) {
-    result.value += a.value;
+  if (is_negative(b)) return PyStr();
+  if (b.big) {
+    if (a.empty()) return PyStr();
+    throw "Repeated string is too long";
+  }
+  return a.repeat(b.value);
+}
+
+auto mul(PyInt const& a, PyStr const& b) -> PyObj { return mul(b, a); }
+
+auto pow(PyObj const& a, PyObj const& b) -> PyObj {
+  return binary_op(Op::pow, a, b);
+}
+
+auto pow(PyInt const& a, PyInt const& b) -> PyObj {
+  if (is_negative(b)) return pow(to_float(a), to_float(b));
+
+  if (!a.big && !b.big) {
+    // Exponentiation by squaring, until a step overflows.
+    long result = 1;
+    long square = a.value;
+    bool overflow = false;
+    for (auto exp = b.value; exp != 0 && !overflow; exp >>= 1) {
+      if (exp & 1) overflow = __builtin_mul_overflow(result, square, &result);
+      if (exp > 1) {
+        overflow = overflow || __builtin_mul_overflow(square, square, &square);
+      }
+    }
+    if (!overflow) return PyInt(result);
   }
+
+  if (b.big) {
+    if (!a.big && (a.value == 0 || a.value == 1)) return a;
+    if (!a.big && a.value == -1) return PyInt(b.big->limbs[0] & 1 ? -1 : 1);
+    throw "Exponent too large";
+  }
+  return make_int(pow(make_bigint(a), static_cast<unsigned long>(b.value)));
+}
+
+auto pow(PyFloat const& a, PyFloat const& b) -> PyObj {
+  if (a.value == 0 && b.value < 0) throw "Division by zero";
+  // Python would give a complex number.
+  if (a.value < 0 && std::isfinite(b.value) && b.value != std::floor(b.value)) {
+    throw "Negative number cannot be raised to a fractional power";
+  }
+  auto result = std::pow(a.value, b.value);
+  if (std::isinf(result) && std::isfinite(a.value) && std::isfinite(b.value)) {
+    throw "Numerical result out of range";
+  }
+  return PyFloat(result);
+}
+
+auto pow_mod(PyObj const& base, PyObj const& exp, PyObj const& m) -> PyObj {
+  auto b = as_int(base);
+  auto e = as_int(exp);
+  auto n = as_int(m);
+  if (b == nullptr || e == nullptr || n == nullptr) {
+    throw "pow() arguments must be integers";
+  }
+  return pow_mod(*b, *e, *n);
+}
+
+auto pow_mod(PyInt const& base, PyInt const& exp, PyInt const& m) -> PyObj {
+  if (base.big || exp.big || m.big) {
+    return make_int(
+        pow_mod(make_bigint(base), make_bigint(exp), make_bigint(m)));
+  }
+  if (m.value == 0) throw "pow() 3rd argument cannot be 0";
+
+  // A negative exponent raises the inverse of base to its magnitude.
+  __int128 result = floor_mod(1, m.value);
+  __int128 square = exp.value < 0 ? floor_mod(inverse_mod(base.value, m.value),
+                                               m.value)
+                                  : floor_mod(base.value, m.value);
+  auto exp_bits = static_cast<unsigned long>(exp.value);
+  if (exp.value < 0) exp_bits = -exp_bits;
+  // Every product of two residues fits in 128 bits.
+  for (; exp_bits != 0; exp_bits >>= 1) {
+    if (exp_bits & 1) result = floor_mod(result * square, m.value);
+    square = floor_mod(square * square, m.value);
+  }
+  return PyInt(static_cast<long>(result));
+}
+
+void print(std::ostream& out, PyObj const& obj) {
+  char buffer[std::max(float_chars, int_chars)];
+  if (auto i = mpark::get_if<PyInt>(&obj)) {
+    if (!i->big) {
+      out.write(buffer, format_int(i->value, buffer) - buffer);
+      return;
+    }
+  } else if (auto f = mpark::get_if<PyFloat>(&obj)) {
+    out.write(buffer, format_float(f->value, buffer) - buffer);
+    return;
+  } else if (auto s = mpark::get_if<PyStr>(&obj)) {
+    out.write(s->data(), s->size());
+    return;
+  }
+  auto text = str(obj);
+  out.write(text.data(), text.size());
+}
+
+auto repr(PyObj const& obj) -> PyStr {
+  auto s = mpark::get_if<PyStr>(&obj);
+  if (s == nullptr) return str(obj);
+
+  // Single quotes unless only double quotes avoid escaping, as in Python.
+  auto has = [&](char c) {
+    return std::memchr(s->data(), c, s->size()) != nullptr;
+  };
+  char quote = has('\'') && !has('"') ? '"' : '\'';
+  std::string result(1, quote);
+  result.reserve(s->size() + 2);
+  for (std::size_t i = 0; i < s->size(); ++i) {
+    auto c = s->data()[i];
+    if (c == quote || c == '\\') {
+      result += '\\';
+      result += c;
+    } else if (c == '\n') {
+      result += "\\n";
+    } else if (c == '\r') {
+      result += "\\r";
+    } else if (c == '\t') {
+      result += "\\t";
+    } else if (static_cast<unsigned char>(c) < 0x20 || c == 0x7f) {
+      char const* hex = "0123456789abcdef";
+      result += "\\x";
+      result += hex[(c >> 4) & 0xf];
+      result += hex[c & 0xf];
+    } else {
+      result += c;
+    }
+  }
+  result += quote;
   return result;
 }
 
+auto rshift(PyObj const& a, PyObj const& b) -> PyObj {
+  return binary_op(Op::rshift, a, b);
+}
+
+auto rshift(PyInt const& a, PyInt const& b) -> PyObj {
+  if (is_negative(b)) throw "Negative shift count";
+  if (b.big) return PyInt(is_negative(a) ? -1 : 0);
+
+  auto count = static_cast<unsigned long>(b.value);
+  if (!a.big) {
+    // Shifting by the width or more leaves only the sign.
+    auto digits = std::numeric_limits<long>::digits;
+    return PyInt(a.value >> std::min<unsigned long>(count, digits));
+  }
+  return make_int(rshift(*a.big, count));
+}
+
 auto str(PyObj const& term) -> PyStr {
   auto visitor = [](auto&& term) { return str(term); };
   return mpark::visit(visitor, term);
 }
 
-auto str(PyInt const& i) -> PyStr { return std::to_string(i.value); }
+auto str(PyFloat const& f) -> PyStr {
+  char buffer[float_chars];
+  return PyStr(buffer, format_float(f.value, buffer) - buffer);
+}
+auto str(PyInt const& i) -> PyStr {
+  if (i.big) return to_string(*i.big);
+  char buffer[int_chars];
+  return PyStr(buffer, format_int(i.value, buffer) - buffer);
+}
 auto str(PyStr const& str) -> PyStr { return str; }
+auto str(PyRange const& r) -> PyStr {
+  auto result = "range(" + format_int(r.start) + ", " + format_int(r.stop);
+  if (r.step != 1) result += ", " + format_int(r.step);
+  return result + ")";
+}
+auto str(PyList const& l) -> PyStr {
+  std::string result = "[";
+  for (std::size_t i = 0; i < l.values.size(); ++i) {
+    if (i > 0) result += ", ";
+    auto item = repr(*l.values[i]);
+    result.append(item.data(), item.size());
+  }
+  return result + "]";
+}
+auto str(PyDict const& d) -> PyStr {
+  std::string result = "{";
+  for (auto&& entry : d.entries()) {
+    if (result.size() > 1) result += ", ";
+    auto key = repr(*entry.key);
+    auto value = repr(*entry.value);
+    result.append(key.data(), key.size());
+    result += ": ";
+    result.append(value.data(), value.size());
+  }
+  return result + "}";
+}
+auto str(PyTuple const& t) -> PyStr {
+  std::string result = "(";
+  for (std::size_t i = 0; i < t.size(); ++i) {
+    if (i > 0) result += ", ";
+    auto item = repr(*t[i]);
+    result.append(item.data(), item.size());
+  }
+  // A tuple of one is told apart from a parenthesised value by its comma.
+  return result + (t.size() == 1 ? ",)" : ")");
+}
 auto str(PyNoneType const& n) -> PyStr { return "None"; }
 auto str(PyBool const& b) -> PyStr { return (b.value != 0) ? "True" : "False"; }
 
+auto subscript(PyObj const& value, PyObj const& index)
+    -> std::shared_ptr<PyObj> {
+  if (auto l = mpark::get_if<PyList>(&value)) {
+    return l->values[position(index, l->values.size())];
+  }
+  if (auto r = mpark::get_if<PyRange>(&value)) {
+    auto pos = position(index, length(*r));
+    // Wraps like the loop counter, and lands in range.
+    auto offset = static_cast<unsigned long>(pos) * r->step;
+    return std::make_shared<PyObj>(PyInt(static_cast<long>(
+        static_cast<unsigned long>(r->start) + offset)));
+  }
+  if (auto t = mpark::get_if<PyTuple>(&value)) {
+    return (*t)[position(index, t->size())];
+  }
+  if (auto d = mpark::get_if<PyDict>(&value)) {
+    auto item = d->get(index);
+    if (!item) throw "KeyError";
+    return item;
+  }
+  if (auto s = mpark::get_if<PyStr>(&value)) {
+    auto begin = s->offset(position(index, s->length()));
+    return std::make_shared<PyObj>(
+        PyStr(s->data() + begin, s->next(begin) - begin));
+  }
+  throw "Object is not subscriptable";
+}
+
+void store_subscript(PyObj& value, std::shared_ptr<PyObj> index,
+                     std::shared_ptr<PyObj> item) {
+  if (auto d = mpark::get_if<PyDict>(&value)) {
+    d->set(std::move(index), std::move(item));
+    return;
+  }
+  auto l = mpark::get_if<PyList>(&value);
+  if (l == nullptr) throw "Object does not support item assignment";
+  l->values[position(*index, l->values.size())] = std::move(item);
+}
+
 auto sub(PyObj const& a, PyObj const& b) -> PyObj {
-  auto visitor = [](auto&& a, auto&& b) { return sub(a, b); };
-  return mpark::visit(visitor, a, b);
+  return binary_op(Op::sub, a, b);
 }
 
 auto sub(PyInt const& a, PyInt const& b) -> PyObj {
-  return PyInt(a.value - b.value);
+  long result = 0;
+  if (!a.big && !b.big &&
+      !__builtin_sub_overflow(a.value, b.value, &result)) {
+    return PyInt(result);
+  }
+  return make_int(sub(make_bigint(a), make_bigint(b)));
+}
+
+auto sub(PyFloat const& a, PyFloat const& b) -> PyObj {
+  return PyFloat(a.value - b.value);
 }
 
 auto truth_value(PyObj const& term) -> bool {
@@ -355,6 +1584,30 @@ auto truth_value(PyObj const& term) -> bool {
 }
 
 auto truth_value(PyNoneType const& n) -> bool { return false; }
-auto truth_value(PyStr const& str) -> bool { return !str.value.empty(); }
-auto truth_value(PyInt const& i) -> bool { return i.value != 0; }
+auto truth_value(PyBool const& b) -> bool { return b.value != 0; }
+auto truth_value(PyStr const& str) -> bool { return !str.empty(); }
+auto truth_value(PyInt const& i) -> bool { return i.big || i.value != 0; }
+auto truth_value(PyFloat const& f) -> bool { return f.value != 0; }
+auto truth_value(PyRange const& r) -> bool { return length(r) != 0; }
+auto truth_value(PyList const& l) -> bool { return !l.values.empty(); }
+auto truth_value(PyDict const& d) -> bool { return !d.empty(); }
+auto truth_value(PyTuple const& t) -> bool { return !t.empty(); }
+
+auto unpack(PyObj const& value, std::size_t n)
+    -> std::shared_ptr<PyObj> const* {
+  std::shared_ptr<PyObj> const* values = nullptr;
+  std::size_t size = 0;
+  if (auto t = mpark::get_if<PyTuple>(&value)) {
+    values = t->begin();
+    size = t->size();
+  } else if (auto l = mpark::get_if<PyList>(&value)) {
+    values = l->values.data();
+    size = l->values.size();
+  } else {
+    throw "Cannot unpack a non-sequence";
+  }
+  if (size > n) throw "Too many values to unpack";
+  if (size < n) throw "Not enough values to unpack";
+  return values;
+}
 }  // namespace MyPython
\ No newline at end of file
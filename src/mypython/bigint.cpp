@@ -0,0 +1,569 @@
+#include <mypython/bigint.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include <mypython/format.hpp>
+
+namespace MyPython {
+namespace {
+using Limbs = std::vector<std::uint32_t>;
+
+constexpr int limb_bits = 32;
+
+void trim(Limbs& a) {
+  while (!a.empty() && a.back() == 0) a.pop_back();
+}
+
+auto cmp_mag(Limbs const& a, Limbs const& b) -> int {
+  if (a.size() != b.size()) return a.size() < b.size() ? -1 : 1;
+  for (auto i = a.size(); i-- > 0;) {
+    if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+  }
+  return 0;
+}
+
+auto add_mag(Limbs const& a, Limbs const& b) -> Limbs {
+  auto const& longer = a.size() < b.size() ? b : a;
+  auto const& shorter = a.size() < b.size() ? a : b;
+  Limbs result(longer.size() + 1);
+  std::uint64_t carry = 0;
+  for (std::size_t i = 0; i < longer.size(); ++i) {
+    carry += longer[i];
+    if (i < shorter.size()) carry += shorter[i];
+    result[i] = static_cast<std::uint32_t>(carry);
+    carry >>= limb_bits;
+  }
+  result.back() = static_cast<std::uint32_t>(carry);
+  trim(result);
+  return result;
+}
+
+// Requires |a| >= |b|.
+auto sub_mag(Limbs const& a, Limbs const& b) -> Limbs {
+  Limbs result(a.size());
+  std::int64_t borrow = 0;
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    std::int64_t diff = static_cast<std::int64_t>(a[i]) - borrow;
+    if (i < b.size()) diff -= b[i];
+    borrow = diff < 0;
+    result[i] = static_cast<std::uint32_t>(diff + (borrow << limb_bits));
+  }
+  trim(result);
+  return result;
+}
+
+// Adds x, shifted up by shift limbs, into acc, which must be wide enough to
+// hold the sum.
+void add_shifted(Limbs& acc, Limbs const& x, std::size_t shift) {
+  std::uint64_t carry = 0;
+  std::size_t i = 0;
+  for (; i < x.size(); ++i) {
+    carry += static_cast<std::uint64_t>(acc[shift + i]) + x[i];
+    acc[shift + i] = static_cast<std::uint32_t>(carry);
+    carry >>= limb_bits;
+  }
+  for (; carry != 0; ++i) {
+    carry += acc[shift + i];
+    acc[shift + i] = static_cast<std::uint32_t>(carry);
+    carry >>= limb_bits;
+  }
+}
+
+auto schoolbook(Limbs const& a, Limbs const& b) -> Limbs {
+  Limbs result(a.size() + b.size());
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    std::uint64_t carry = 0;
+    for (std::size_t j = 0; j < b.size(); ++j) {
+      carry += static_cast<std::uint64_t>(a[i]) * b[j] + result[i + j];
+      result[i + j] = static_cast<std::uint32_t>(carry);
+      carry >>= limb_bits;
+    }
+    result[i + b.size()] = static_cast<std::uint32_t>(carry);
+  }
+  trim(result);
+  return result;
+}
+
+auto slice(Limbs const& a, std::size_t begin, std::size_t end) -> Limbs {
+  begin = std::min(begin, a.size());
+  end = std::min(end, a.size());
+  Limbs result(a.begin() + begin, a.begin() + end);
+  trim(result);
+  return result;
+}
+
+// Splits both operands at half the longer one's length, so that
+// a * b = z2 * B^2 + z1 * B + z0 takes three half-size products.
+auto mul_mag(Limbs const& a, Limbs const& b) -> Limbs {
+  if (a.empty() || b.empty()) return {};
+  if (std::min(a.size(), b.size()) < karatsuba_threshold) {
+    return schoolbook(a, b);
+  }
+
+  auto half = std::max(a.size(), b.size()) / 2;
+  auto a0 = slice(a, 0, half);
+  auto a1 = slice(a, half, a.size());
+  auto b0 = slice(b, 0, half);
+  auto b1 = slice(b, half, b.size());
+
+  auto z0 = mul_mag(a0, b0);
+  auto z2 = mul_mag(a1, b1);
+  auto z1 = mul_mag(add_mag(a0, a1), add_mag(b0, b1));
+  z1 = sub_mag(sub_mag(z1, z0), z2);
+
+  Limbs result(a.size() + b.size() + 1);
+  add_shifted(result, z0, 0);
+  add_shifted(result, z1, half);
+  add_shifted(result, z2, 2 * half);
+  trim(result);
+  return result;
+}
+
+// Divides a in place by a single limb, returning the remainder.
+auto div_limb(Limbs& a, std::uint32_t divisor) -> std::uint32_t {
+  std::uint64_t rem = 0;
+  for (auto i = a.size(); i-- > 0;) {
+    auto cur = (rem << limb_bits) | a[i];
+    a[i] = static_cast<std::uint32_t>(cur / divisor);
+    rem = cur % divisor;
+  }
+  trim(a);
+  return static_cast<std::uint32_t>(rem);
+}
+
+auto shl_mag(Limbs const& a, unsigned long count) -> Limbs {
+  if (a.empty()) return {};
+  auto limbs = count / limb_bits;
+  auto bits = count % limb_bits;
+  Limbs result(limbs + a.size() + 1);
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    auto wide = static_cast<std::uint64_t>(a[i]) << bits;
+    result[limbs + i] |= static_cast<std::uint32_t>(wide);
+    result[limbs + i + 1] = static_cast<std::uint32_t>(wide >> limb_bits);
+  }
+  trim(result);
+  return result;
+}
+
+auto shr_mag(Limbs const& a, unsigned long count) -> Limbs {
+  auto limbs = count / limb_bits;
+  auto bits = count % limb_bits;
+  if (limbs >= a.size()) return {};
+  Limbs result(a.size() - limbs);
+  for (std::size_t i = 0; i < result.size(); ++i) {
+    std::uint64_t wide = a[limbs + i];
+    if (limbs + i + 1 < a.size()) {
+      wide |= static_cast<std::uint64_t>(a[limbs + i + 1]) << limb_bits;
+    }
+    result[i] = static_cast<std::uint32_t>(wide >> bits);
+  }
+  trim(result);
+  return result;
+}
+
+// Truncating division of magnitudes, by Knuth's algorithm D.
+void divmod_mag(Limbs const& a, Limbs const& b, Limbs& quot, Limbs& rem) {
+  if (cmp_mag(a, b) < 0) {
+    quot.clear();
+    rem = a;
+    return;
+  }
+  if (b.size() == 1) {
+    quot = a;
+    rem = {div_limb(quot, b[0])};
+    trim(rem);
+    return;
+  }
+
+  // Normalise so that the divisor's top limb has its high bit set, which
+  // keeps each estimated quotient limb at most two too large.
+  auto shift = __builtin_clz(b.back());
+  auto v = shl_mag(b, shift);
+  auto u = shl_mag(a, shift);
+  u.resize(a.size() + 1);
+  auto n = v.size();
+  auto m = u.size() - n;
+  quot.assign(m, 0);
+
+  std::uint64_t const base = 1ULL << limb_bits;
+  for (auto j = m; j-- > 0;) {
+    auto top = (static_cast<std::uint64_t>(u[j + n]) << limb_bits) |
+               u[j + n - 1];
+    auto qhat = top / v[n - 1];
+    auto rhat = top % v[n - 1];
+    while (qhat >= base ||
+           qhat * v[n - 2] > ((rhat << limb_bits) | u[j + n - 2])) {
+      --qhat;
+      rhat += v[n - 1];
+      if (rhat >= base) break;
+    }
+
+    // Subtract qhat * v from the current window of u.
+    std::int64_t borrow = 0;
+    std::uint64_t carry = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      auto product = qhat * v[i] + carry;
+      carry = product >> limb_bits;
+      auto diff = static_cast<std::int64_t>(u[i + j]) - borrow -
+                  static_cast<std::int64_t>(product & (base - 1));
+      u[i + j] = static_cast<std::uint32_t>(diff);
+      borrow = diff < 0;
+    }
+    auto diff = static_cast<std::int64_t>(u[j + n]) - borrow -
+                static_cast<std::int64_t>(carry);
+    u[j + n] = static_cast<std::uint32_t>(diff);
+
+    // The estimate was one too large; add v back.
+    if (diff < 0) {
+      --qhat;
+      carry = 0;
+      for (std::size_t i = 0; i < n; ++i) {
+        auto sum = static_cast<std::uint64_t>(u[i + j]) + v[i] + carry;
+        u[i + j] = static_cast<std::uint32_t>(sum);
+        carry = sum >> limb_bits;
+      }
+      u[j + n] += static_cast<std::uint32_t>(carry);
+    }
+    quot[j] = static_cast<std::uint32_t>(qhat);
+  }
+
+  trim(quot);
+  u.resize(n);
+  rem = shr_mag(u, shift);
+}
+
+// The low width limbs of a in two's complement.
+auto to_twos(BigInt const& a, std::size_t width) -> Limbs {
+  auto result = a.limbs;
+  result.resize(width);
+  if (!a.negative) return result;
+  // -x == ~(x - 1)
+  for (auto& limb : result) {
+    auto was_zero = limb == 0;
+    --limb;
+    if (!was_zero) break;
+  }
+  for (auto& limb : result) limb = ~limb;
+  return result;
+}
+
+auto from_twos(Limbs twos) -> BigInt;
+
+template <class F>
+auto bitwise(BigInt const& a, BigInt const& b, F op) -> BigInt {
+  // One spare limb holds the sign bit of either operand.
+  auto width = std::max(a.limbs.size(), b.limbs.size()) + 1;
+  auto x = to_twos(a, width);
+  auto y = to_twos(b, width);
+  for (std::size_t i = 0; i < width; ++i) x[i] = op(x[i], y[i]);
+  return from_twos(std::move(x));
+}
+
+auto make_signed(bool negative, Limbs limbs) -> BigInt {
+  BigInt result;
+  result.negative = negative && !limbs.empty();
+  result.limbs = std::move(limbs);
+  return result;
+}
+
+auto from_twos(Limbs twos) -> BigInt {
+  bool negative = !twos.empty() && (twos.back() >> (limb_bits - 1)) != 0;
+  if (negative) {
+    // x == ~(-x) + 1
+    for (auto& limb : twos) limb = ~limb;
+    for (auto& limb : twos) {
+      if (++limb != 0) break;
+    }
+  }
+  trim(twos);
+  return make_signed(negative, std::move(twos));
+}
+
+auto is_zero(BigInt const& a) -> bool { return a.limbs.empty(); }
+
+auto bit_length(Limbs const& a) -> long {
+  if (a.empty()) return 0;
+  return (a.size() - 1) * limb_bits + limb_bits - __builtin_clz(a.back());
+}
+
+// Whether any of the low count bits of a are set.
+auto any_low_bits(Limbs const& a, long count) -> bool {
+  auto limbs = std::min<std::size_t>(count / limb_bits, a.size());
+  for (std::size_t i = 0; i < limbs; ++i) {
+    if (a[i] != 0) return true;
+  }
+  auto bits = count % limb_bits;
+  return limbs < a.size() && (a[limbs] & ((1U << bits) - 1)) != 0;
+}
+
+// Rounds a magnitude to a double. The top 64 bits convert with one rounding;
+// any bits below them are folded into the lowest, which decides ties.
+auto mag_to_double(Limbs const& a) -> double {
+  auto shift = std::max(0L, bit_length(a) - 64);
+  auto top = shr_mag(a, shift);
+  std::uint64_t bits = 0;
+  for (auto i = top.size(); i-- > 0;) bits = (bits << limb_bits) | top[i];
+  if (any_low_bits(a, shift)) bits |= 1;
+  return std::ldexp(static_cast<double>(bits), shift);
+}
+
+// Rounds a truncated quotient and remainder toward negative infinity.
+void floor_divmod(BigInt const& a, BigInt const& b, BigInt& quot,
+                  BigInt& rem) {
+  if (is_zero(b)) throw "Division by zero";
+  Limbs q;
+  Limbs r;
+  divmod_mag(a.limbs, b.limbs, q, r);
+  bool negative = a.negative != b.negative;
+  if (negative && !r.empty()) {
+    q = add_mag(q, {1});
+    r = sub_mag(b.limbs, r);
+  }
+  quot = make_signed(negative, std::move(q));
+  rem = make_signed(b.negative, std::move(r));
+}
+
+// 10^9, the largest power of ten in a limb.
+constexpr std::uint32_t chunk = 1000000000;
+constexpr int chunk_digits = 9;
+
+// Magnitudes smaller than this many limbs are converted to decimal by
+// repeated division by 10^9 rather than by splitting.
+constexpr std::size_t split_threshold = 32;
+
+// Writes a, which is less than powers[k]^2, as exactly 9 << (k + 1) digits.
+// powers[i] is 10^(9 * 2^i). Large values are split at powers[k] and each
+// half converted recursively, so the divisions work on balanced operands.
+void write_digits(Limbs const& a, std::vector<Limbs> const& powers, int k,
+                  char* out) {
+  auto width = chunk_digits << (k + 1);
+  if (k == 0 || a.size() < split_threshold) {
+    auto mag = a;
+    for (auto end = out + width; !mag.empty(); end -= chunk_digits) {
+      format_padded(div_limb(mag, chunk), chunk_digits, end - chunk_digits);
+    }
+    return;
+  }
+  Limbs high;
+  Limbs low;
+  divmod_mag(a, powers[k], high, low);
+  write_digits(high, powers, k - 1, out);
+  write_digits(low, powers, k - 1, out + width / 2);
+}
+
+auto magnitude(BigInt const& a) -> unsigned long {
+  unsigned long mag = 0;
+  for (auto i = a.limbs.size(); i-- > 0;) {
+    mag = (mag << limb_bits) | a.limbs[i];
+  }
+  return mag;
+}
+
+// The inverse of a modulo m in [0, |m|), by the extended Euclidean algorithm.
+auto inverse_mod(BigInt const& a, BigInt const& m) -> BigInt {
+  auto n = make_signed(false, m.limbs);
+  auto r = mod(a, n);
+  auto next_r = n;
+  auto s = make_bigint(1);
+  auto next_s = make_bigint(0);
+  while (!is_zero(next_r)) {
+    auto q = floor_div(r, next_r);
+    r = sub(r, mul(q, next_r));
+    std::swap(r, next_r);
+    s = sub(s, mul(q, next_s));
+    std::swap(s, next_s);
+  }
+  if (cmp(r, make_bigint(1)) != 0) {
+    throw "base is not invertible for the given modulus";
+  }
+  return mod(s, n);
+}
+}  // namespace
+
+auto make_bigint(long value) -> BigInt {
+  // Negating in unsigned arithmetic keeps LONG_MIN well defined.
+  auto mag = static_cast<unsigned long>(value);
+  if (value < 0) mag = 0UL - mag;
+
+  Limbs limbs;
+  for (; mag != 0; mag >>= limb_bits) {
+    limbs.push_back(static_cast<std::uint32_t>(mag));
+  }
+  return make_signed(value < 0, std::move(limbs));
+}
+
+auto make_bigint(PyInt const& i) -> BigInt {
+  if (i.big) return *i.big;
+  return make_bigint(i.value);
+}
+
+auto fits_long(BigInt const& a) -> bool {
+  auto digits = std::numeric_limits<unsigned long>::digits;
+  if (a.limbs.size() * limb_bits > digits) return false;
+  auto limit = static_cast<unsigned long>(std::numeric_limits<long>::max());
+  return magnitude(a) <= limit + a.negative;
+}
+
+auto to_long(BigInt const& a) -> long {
+  auto mag = magnitude(a);
+  if (!a.negative) return static_cast<long>(mag);
+  if (mag == 0) return 0;
+  return -static_cast<long>(mag - 1) - 1;
+}
+
+auto make_int(BigInt value) -> PyInt {
+  if (fits_long(value)) return PyInt(to_long(value));
+  PyInt result;
+  result.big = std::make_shared<BigInt const>(std::move(value));
+  return result;
+}
+
+auto truncate_to_bigint(double value) -> BigInt {
+  if (!std::isfinite(value)) throw "Cannot convert float to integer";
+  int exp = 0;
+  auto frac = std::frexp(std::fabs(value), &exp);
+  auto mant = static_cast<std::uint64_t>(std::ldexp(frac, 64));
+  Limbs limbs = {static_cast<std::uint32_t>(mant),
+                 static_cast<std::uint32_t>(mant >> limb_bits)};
+  trim(limbs);
+  exp -= 64;
+  auto mag = exp >= 0 ? shl_mag(limbs, exp) : shr_mag(limbs, -exp);
+  return make_signed(value < 0, std::move(mag));
+}
+
+auto to_double(BigInt const& a) -> double {
+  auto result = mag_to_double(a.limbs);
+  if (std::isinf(result)) throw "Integer too large to convert to float";
+  return a.negative ? -result : result;
+}
+
+auto true_div(BigInt const& a, BigInt const& b) -> double {
+  if (is_zero(b)) throw "Division by zero";
+  auto sign = a.negative != b.negative ? -1.0 : 1.0;
+  if (is_zero(a)) return sign * 0.0;
+
+  // Scale so that the quotient has at least 66 bits, then round it once.
+  auto shift = 66 + bit_length(b.limbs) - bit_length(a.limbs);
+  auto num = shift > 0 ? shl_mag(a.limbs, shift) : a.limbs;
+  auto den = shift < 0 ? shl_mag(b.limbs, -shift) : b.limbs;
+  Limbs quot;
+  Limbs rem;
+  divmod_mag(num, den, quot, rem);
+  if (!rem.empty()) quot[0] |= 1;
+
+  auto result = std::ldexp(mag_to_double(quot), -shift);
+  if (std::isinf(result)) throw "Integer division result too large for a float";
+  return sign * result;
+}
+
+auto add(BigInt const& a, BigInt const& b) -> BigInt {
+  if (a.negative == b.negative) {
+    return make_signed(a.negative, add_mag(a.limbs, b.limbs));
+  }
+  if (cmp_mag(a.limbs, b.limbs) >= 0) {
+    return make_signed(a.negative, sub_mag(a.limbs, b.limbs));
+  }
+  return make_signed(b.negative, sub_mag(b.limbs, a.limbs));
+}
+
+auto sub(BigInt const& a, BigInt const& b) -> BigInt {
+  auto negated = b;
+  negated.negative = !b.negative && !b.limbs.empty();
+  return add(a, negated);
+}
+
+auto mul(BigInt const& a, BigInt const& b) -> BigInt {
+  return make_signed(a.negative != b.negative, mul_mag(a.limbs, b.limbs));
+}
+
+auto cmp(BigInt const& a, BigInt const& b) -> int {
+  if (a.negative != b.negative) return a.negative ? -1 : 1;
+  auto result = cmp_mag(a.limbs, b.limbs);
+  return a.negative ? -result : result;
+}
+
+auto floor_div(BigInt const& a, BigInt const& b) -> BigInt {
+  BigInt quot;
+  BigInt rem;
+  floor_divmod(a, b, quot, rem);
+  return quot;
+}
+
+auto mod(BigInt const& a, BigInt const& b) -> BigInt {
+  BigInt quot;
+  BigInt rem;
+  floor_divmod(a, b, quot, rem);
+  return rem;
+}
+
+auto pow(BigInt const& base, unsigned long exp) -> BigInt {
+  auto result = make_bigint(1);
+  auto square = base;
+  while (true) {
+    if (exp & 1) result = mul(result, square);
+    exp >>= 1;
+    if (exp == 0) return result;
+    square = mul(square, square);
+  }
+}
+
+auto pow_mod(BigInt const& base, BigInt const& exp, BigInt const& m) -> BigInt {
+  if (is_zero(m)) throw "pow() 3rd argument cannot be 0";
+
+  // A negative exponent raises the inverse of base to its magnitude, which is
+  // all the loop below reads of exp.
+  auto result = mod(make_bigint(1), m);
+  auto square = mod(exp.negative ? inverse_mod(base, m) : base, m);
+  auto bits = exp.limbs.size() * limb_bits;
+  for (std::size_t i = 0; i < bits; ++i) {
+    if ((exp.limbs[i / limb_bits] >> (i % limb_bits)) & 1) {
+      result = mod(mul(result, square), m);
+    }
+    square = mod(mul(square, square), m);
+  }
+  return result;
+}
+
+auto lshift(BigInt const& a, unsigned long count) -> BigInt {
+  return make_signed(a.negative, shl_mag(a.limbs, count));
+}
+
+auto rshift(BigInt const& a, unsigned long count) -> BigInt {
+  if (!a.negative) return make_signed(false, shr_mag(a.limbs, count));
+  // floor(-x / 2^n) == -((x - 1) / 2^n) - 1
+  auto less = sub_mag(a.limbs, {1});
+  return make_signed(true, add_mag(shr_mag(less, count), {1}));
+}
+
+auto bit_and(BigInt const& a, BigInt const& b) -> BigInt {
+  return bitwise(a, b, [](std::uint32_t x, std::uint32_t y) { return x & y; });
+}
+
+auto bit_or(BigInt const& a, BigInt const& b) -> BigInt {
+  return bitwise(a, b, [](std::uint32_t x, std::uint32_t y) { return x | y; });
+}
+
+auto bit_xor(BigInt const& a, BigInt const& b) -> BigInt {
+  return bitwise(a, b, [](std::uint32_t x, std::uint32_t y) { return x ^ y; });
+}
+
+auto to_string(BigInt const& a) -> std::string {
+  if (a.limbs.empty()) return "0";
+
+  // Square 10^9 until the square of the largest power must exceed a, so
+  // that the digits fit a buffer of 9 << (k + 1) characters.
+  std::vector<Limbs> powers = {{chunk}};
+  while (2 * powers.back().size() - 1 <= a.limbs.size()) {
+    powers.push_back(mul_mag(powers.back(), powers.back()));
+  }
+  auto k = static_cast<int>(powers.size()) - 1;
+  std::string digits(std::size_t{chunk_digits} << (k + 1), '0');
+  write_digits(a.limbs, powers, k, &digits[0]);
+
+  auto first = digits.find_first_not_of('0');
+  return (a.negative ? "-" : "") + digits.substr(first);
+}
+}  // namespace MyPython
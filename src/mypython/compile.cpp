@@ -0,0 +1,685 @@
+#include <mypython/vm.hpp>
+
+#include <algorithm>
+
+#include <mypython/scope.hpp>
+#include <util/variant.hpp>
+
+namespace MyPython {
+namespace {
+// Points the innermost forward jump that is still pending at the next
+// instruction.
+struct Patch {};
+
+// Pending compilation work. Expressions expand into further tasks and Instrs
+// are appended as they are. Expressions are compiled from this explicit stack
+// so that the depth of an expression tree never reaches the native stack.
+using Task = mpark::variant<Expression const*, Instr, Patch>;
+
+auto emit(Code& code, OpCode op, int arg = 0) -> int {
+  Instr instr;
+  instr.op = op;
+  instr.arg = arg;
+  code.instrs.push_back(instr);
+  return code.instrs.size() - 1;
+}
+
+auto instr(OpCode op, int arg) -> Instr {
+  Instr instr;
+  instr.op = op;
+  instr.arg = arg;
+  return instr;
+}
+
+auto add_const(Code& code, PyObj const& value) -> int {
+  code.consts.push_back(std::make_shared<PyObj>(value));
+  return code.consts.size() - 1;
+}
+
+auto add_name(Code& code, std::string const& name) -> int {
+  auto it = std::find(code.names.begin(), code.names.end(), name);
+  if (it != code.names.end()) return it - code.names.begin();
+  code.names.push_back(name);
+  return code.names.size() - 1;
+}
+
+// Returns the slot of a local or free variable, or -1 for a global.
+auto slot_of_name(Code const& code, std::string const& name) -> int {
+  if (!code.scope) return -1;
+  auto slot = slot_of(*code.scope, name);
+  if (slot >= 0) return slot;
+
+  auto const& free = code.scope->free;
+  auto it = std::find(free.begin(), free.end(), name);
+  if (it == free.end()) return -1;
+  return code.nlocals + (it - free.begin());
+}
+
+void emit_load(Code& code, std::string const& name) {
+  auto slot = slot_of_name(code, name);
+  if (slot < 0) {
+    emit(code, OpCode::load_global, add_name(code, name));
+  } else if (slot >= code.nlocals) {
+    emit(code, OpCode::load_free, slot - code.nlocals);
+  } else if (is_cell(*code.scope, name)) {
+    emit(code, OpCode::load_deref, slot);
+  } else {
+    emit(code, OpCode::load_fast, slot);
+  }
+}
+
+void emit_store(Code& code, std::string const& name) {
+  auto slot = slot_of_name(code, name);
+  if (slot < 0) {
+    emit(code, OpCode::store_global, add_name(code, name));
+  } else if (is_cell(*code.scope, name)) {
+    emit(code, OpCode::store_deref, slot);
+  } else {
+    emit(code, OpCode::store_fast, slot);
+  }
+}
+
+auto add_file(Code& code, std::ostream* file) -> int {
+  auto it = std::find(code.files.begin(), code.files.end(), file);
+  if (it != code.files.end()) return it - code.files.begin();
+  code.files.push_back(file);
+  return code.files.size() - 1;
+}
+
+void compile_expr(Expression const& root, Code& code);
+
+// Pops the value on top of the operand stack into target.
+void emit_target(Expression const& target, Code& code) {
+  auto visitor = Util::make_visitor(
+      [&](Name const& name) { emit_store(code, name.id); },
+      [&](Subscript const& sub) {
+        compile_expr(*sub.value, code);
+        compile_expr(*sub.index, code);
+        emit(code, OpCode::store_subscr);
+      },
+      [&](Tuple const& tuple) {
+        emit(code, OpCode::unpack_sequence, tuple.elts.size());
+        for (auto&& elt : tuple.elts) emit_target(elt, code);
+      },
+      [](auto const&) { throw "Not yet implemented"; });
+  mpark::visit(visitor, target);
+}
+
+// The slot of a local that load_fast and store_fast address, or -1 if name
+// is a global, a free variable or lives in a cell.
+auto fast_slot(Code const& code, Expression const& expr) -> int {
+  auto name = mpark::get_if<Name>(&expr);
+  if (name == nullptr) return -1;
+  auto slot = slot_of_name(code, name->id);
+  if (slot < 0 || slot >= code.nlocals || is_cell(*code.scope, name->id)) {
+    return -1;
+  }
+  return slot;
+}
+
+// Compiles `a, b, c = x, y, z` into stores of the values as they are, with
+// no tuple between them, when the targets are distinct names. `a, b = b, a`
+// between two locals becomes a single exchange of their slots. Returns false,
+// having emitted nothing, if the assignment does not have that form.
+auto compile_unpack_literal(Expression const& target, Expression const& value,
+                            Code& code) -> bool {
+  auto targets = mpark::get_if<Tuple>(&target);
+  auto values = mpark::get_if<Tuple>(&value);
+  if (targets == nullptr || values == nullptr ||
+      targets->elts.size() != values->elts.size()) {
+    return false;
+  }
+  std::vector<std::string> names;
+  for (auto&& elt : targets->elts) {
+    auto name = mpark::get_if<Name>(&elt);
+    if (name == nullptr ||
+        std::find(names.begin(), names.end(), name->id) != names.end()) {
+      return false;
+    }
+    names.push_back(name->id);
+  }
+
+  if (names.size() == 2) {
+    auto a = fast_slot(code, targets->elts[0]);
+    auto b = fast_slot(code, targets->elts[1]);
+    auto first = mpark::get_if<Name>(&values->elts[0]);
+    auto second = mpark::get_if<Name>(&values->elts[1]);
+    if (a >= 0 && b >= 0 && a <= 0xffff && b <= 0xffff && first != nullptr &&
+        second != nullptr && first->id == names[1] && second->id == names[0]) {
+      // Packed unsigned, as b << 16 overflows an int from slot 0x8000.
+      auto packed = static_cast<unsigned>(a) | static_cast<unsigned>(b) << 16;
+      emit(code, OpCode::swap_fast, static_cast<int>(packed));
+      return true;
+    }
+  }
+
+  // Every value is pushed before any is stored. The last is on top, so the
+  // targets are stored from the last, which is safe as they are distinct.
+  for (auto&& elt : values->elts) compile_expr(elt, code);
+  for (auto it = names.rbegin(); it != names.rend(); ++it) {
+    emit_store(code, *it);
+  }
+  return true;
+}
+
+// Compiles a comprehension in place. Only the nesting of comprehensions
+// reaches the native stack.
+void compile_list_comp(ListComp const& comp, Code& code) {
+  emit(code, OpCode::build_list, 0);
+  compile_expr(*comp.iter, code);
+  // Filtered comprehensions may keep far fewer values than the source has.
+  emit(code, OpCode::get_iter, comp.ifs.empty() ? 1 : 0);
+  int top = emit(code, OpCode::for_iter);
+  emit_target(*comp.target, code);
+  for (auto&& test : comp.ifs) {
+    compile_expr(test, code);
+    emit(code, OpCode::jump_if_false, top);
+  }
+  compile_expr(*comp.elt, code);
+  emit(code, OpCode::list_append);
+  emit(code, OpCode::jump, top);
+  code.instrs[top].arg = code.instrs.size();
+}
+
+// Pushes the work for expr onto tasks in reverse, so that it runs in order.
+void schedule(Expression const& expr, Code& code, std::vector<Task>& tasks) {
+  auto visitor = Util::make_visitor(
+      [&](BoolOp const& op) {
+        // The left operand stays on the stack as the result if it decides
+        // it, and the right operand is skipped.
+        auto jump = op.op == BoolOperator::and_op
+                        ? OpCode::jump_if_false_or_pop
+                        : OpCode::jump_if_true_or_pop;
+        tasks.push_back(Patch());
+        tasks.push_back(op.right.get());
+        tasks.push_back(instr(jump, 0));
+        tasks.push_back(op.left.get());
+      },
+      [&](BinOp const& op) {
+        tasks.push_back(instr(OpCode::binary_op, static_cast<int>(op.op)));
+        tasks.push_back(op.right.get());
+        tasks.push_back(op.left.get());
+      },
+      [&](Call const& call) {
+        auto method = mpark::get_if<Attribute>(call.func.get());
+        CallSite site;
+        site.argc = call.args.size();
+        if (method != nullptr) site.method = add_name(code, method->attr);
+        code.call_sites.push_back(site);
+        auto op = method != nullptr ? OpCode::call_method : OpCode::call;
+        tasks.push_back(instr(op, code.call_sites.size() - 1));
+        for (auto it = call.args.rbegin(); it != call.args.rend(); ++it) {
+          tasks.push_back(&*it);
+        }
+        tasks.push_back(method != nullptr ? method->value.get()
+                                          : call.func.get());
+      },
+      [&](Compare const& cmp) {
+        if (cmp.ops.size() != cmp.comparators.size())
+          throw "Not enough ops/comparators";
+
+        // Every link but the last keeps its right operand for the next one
+        // and jumps past the rest of the chain when it is false.
+        int last = cmp.ops.size() - 1;
+        for (int i = 0; i < last; ++i) tasks.push_back(Patch());
+        for (int i = last; i >= 0; --i) {
+          auto op = static_cast<int>(cmp.ops[i]);
+          if (i == last) {
+            tasks.push_back(instr(OpCode::compare_op, op));
+          } else {
+            tasks.push_back(instr(OpCode::jump, 0));
+            tasks.push_back(instr(OpCode::compare_link, op));
+          }
+          tasks.push_back(&cmp.comparators[i]);
+        }
+        tasks.push_back(cmp.left.get());
+      },
+      [&](Num const& num) {
+        emit(code, OpCode::load_const, add_const(code, PyInt(num.n)));
+      },
+      [&](Str const& str) {
+        emit(code, OpCode::load_const, add_const(code, literal_str(str.s)));
+      },
+      [&](NameConstant const& nc) {
+        PyObj value;
+        if (nc.value == Singleton::true_value) {
+          PyBool b;
+          b.value = true;
+          value = b;
+        } else if (nc.value == Singleton::false_value) {
+          value = PyBool();
+        }
+        emit(code, OpCode::load_const, add_const(code, value));
+      },
+      [&](Name const& name) { emit_load(code, name.id); },
+      [&](Attribute const&) { throw "Not yet implemented"; },
+      [&](List const& list) {
+        tasks.push_back(instr(OpCode::build_list, list.elts.size()));
+        for (auto it = list.elts.rbegin(); it != list.elts.rend(); ++it) {
+          tasks.push_back(&*it);
+        }
+      },
+      [&](ListComp const& comp) { compile_list_comp(comp, code); },
+      [&](Dict const& dict) {
+        if (dict.keys.size() != dict.values.size())
+          throw "Not enough keys/values";
+        tasks.push_back(instr(OpCode::build_map, dict.keys.size()));
+        for (int i = dict.keys.size() - 1; i >= 0; --i) {
+          tasks.push_back(&dict.values[i]);
+          tasks.push_back(&dict.keys[i]);
+        }
+      },
+      [&](Tuple const& tuple) {
+        tasks.push_back(instr(OpCode::build_tuple, tuple.elts.size()));
+        for (auto it = tuple.elts.rbegin(); it != tuple.elts.rend(); ++it) {
+          tasks.push_back(&*it);
+        }
+      },
+      [&](Subscript const& sub) {
+        tasks.push_back(instr(OpCode::binary_subscr, 0));
+        tasks.push_back(sub.index.get());
+        tasks.push_back(sub.value.get());
+      },
+      [&](Yield const& yield) {
+        if (!code.scope) throw "'yield' outside function";
+        tasks.push_back(instr(OpCode::yield_value, 0));
+        if (yield.value) {
+          tasks.push_back(yield.value.get());
+        } else {
+          tasks.push_back(
+              instr(OpCode::load_const, add_const(code, PyNoneType())));
+        }
+      });
+  mpark::visit(visitor, expr);
+}
+
+void compile_expr(Expression const& root, Code& code) {
+  std::vector<Task> tasks = {&root};
+  // Jumps whose targets are not yet known, innermost last. Every jump
+  // scheduled as a task is forward, and a later Patch sets its target.
+  std::vector<int> pending;
+  while (!tasks.empty()) {
+    auto task = std::move(tasks.back());
+    tasks.pop_back();
+
+    if (auto expr = mpark::get_if<Expression const*>(&task)) {
+      schedule(**expr, code, tasks);
+    } else if (auto instr = mpark::get_if<Instr>(&task)) {
+      code.instrs.push_back(*instr);
+      if (instr->op == OpCode::jump ||
+          instr->op == OpCode::jump_if_false_or_pop ||
+          instr->op == OpCode::jump_if_true_or_pop) {
+        pending.push_back(code.instrs.size() - 1);
+      }
+    } else {
+      code.instrs[pending.back()].arg = code.instrs.size();
+      pending.pop_back();
+    }
+  }
+}
+
+void compile_stmt(Statement const& stmt, Code& code);
+
+void compile_body(std::vector<Statement> const& body, Code& code) {
+  for (auto&& stmt : body) compile_stmt(stmt, code);
+}
+
+// Loops over range() with literal bounds are unrolled if they run at most
+// this many times...
+constexpr int max_unrolled_trips = 8;
+// ...and their body is at most this many simple statements.
+constexpr int max_unrolled_statements = 4;
+
+// The arguments of iter if it calls range, or nullptr. Whether range is still
+// the builtin is only known when the loop runs.
+auto range_args(Expression const& iter) -> std::vector<Expression> const* {
+  auto call = mpark::get_if<Call>(&iter);
+  if (call == nullptr) return nullptr;
+  auto callee = mpark::get_if<Name>(call->func.get());
+  if (callee == nullptr || callee->id != "range") return nullptr;
+  if (call->args.empty() || call->args.size() > 3) return nullptr;
+  return &call->args;
+}
+
+// The values of a range() whose arguments are literals, if there are few
+// enough to unroll.
+auto unrolled_values(std::vector<Expression> const& args,
+                     std::vector<long>& values) -> bool {
+  long bounds[3] = {0, 0, 1};
+  for (std::size_t i = 0; i < args.size(); ++i) {
+    auto num = mpark::get_if<Num>(&args[i]);
+    if (num == nullptr) return false;
+    bounds[args.size() == 1 ? 1 : i] = num->n;
+  }
+  auto start = bounds[0], stop = bounds[1], step = bounds[2];
+  if (step == 0) return false;
+  for (auto v = start; step > 0 ? v < stop : v > stop; v += step) {
+    if (values.size() == max_unrolled_trips) return false;
+    values.push_back(v);
+  }
+  return true;
+}
+
+// Whether body is short enough to copy once per trip, and free of nested
+// loops and definitions.
+auto unrollable(std::vector<Statement> const& body) -> bool {
+  if (body.size() > max_unrolled_statements) return false;
+  for (auto&& stmt : body) {
+    if (!mpark::holds_alternative<Assign>(stmt) &&
+        !mpark::holds_alternative<AugAssign>(stmt) &&
+        !mpark::holds_alternative<Expr>(stmt) &&
+        !mpark::holds_alternative<Print>(stmt)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Compiles `for i in range(...)` into a local i. The first value comes from
+// for_iter as in any loop, and the rest from next_count at the foot of the
+// body, which counts without boxing a new int or dispatching a jump per
+// trip. A short loop with literal bounds is unrolled instead, behind a check
+// that range is the builtin.
+void compile_counted_loop(For const& loop, int slot, Code& code) {
+  std::vector<long> values;
+  int to_loop = -1;
+  int to_end = -1;
+  if (unrolled_values(*range_args(*loop.iter), values) &&
+      unrollable(loop.body)) {
+    emit_load(code, "range");
+    to_loop = emit(code, OpCode::jump_if_not_range);
+    for (auto value : values) {
+      emit(code, OpCode::load_const, add_const(code, PyInt(value)));
+      emit(code, OpCode::store_fast, slot);
+      compile_body(loop.body, code);
+    }
+    compile_body(loop.or_else, code);
+    to_end = emit(code, OpCode::jump);
+    code.instrs[to_loop].arg = code.instrs.size();
+  }
+
+  compile_expr(*loop.iter, code);
+  emit(code, OpCode::get_counter, slot);
+  int top = emit(code, OpCode::for_iter);
+  emit(code, OpCode::store_fast, slot);
+  int body = code.instrs.size();
+  compile_body(loop.body, code);
+  emit(code, OpCode::next_count, body);
+  emit(code, OpCode::jump, top);
+  code.instrs[top].arg = code.instrs.size();
+  compile_body(loop.or_else, code);
+  if (to_end >= 0) code.instrs[to_end].arg = code.instrs.size();
+}
+
+// Shorter if/elif chains are left as compares.
+constexpr int min_jump_table_cases = 4;
+// Perfect hash tables may be up to this many times the next power of two
+// above the number of cases.
+constexpr int max_hash_spread = 8;
+
+// The literal a chain link compares the name with, if test is `name == k`
+// for an int or string k.
+auto case_key(Expression const& test, std::string& name)
+    -> std::shared_ptr<PyObj> {
+  auto cmp = mpark::get_if<Compare>(&test);
+  if (cmp == nullptr || cmp->ops.size() != 1 || cmp->ops[0] != CmpOp::eq) {
+    return nullptr;
+  }
+  auto subject = mpark::get_if<Name>(cmp->left.get());
+  if (subject == nullptr) return nullptr;
+  name = subject->id;
+  if (auto num = mpark::get_if<Num>(&cmp->comparators[0])) {
+    return std::make_shared<PyObj>(PyInt(num->n));
+  }
+  if (auto str = mpark::get_if<Str>(&cmp->comparators[0])) {
+    return std::make_shared<PyObj>(literal_str(str->s));
+  }
+  return nullptr;
+}
+
+// Lays keys out in a dense table or a perfect hash, filling in where each
+// key goes. Returns false if they fit neither.
+auto plan_jump_table(std::vector<std::shared_ptr<PyObj>> const& keys,
+                     JumpTable& table, std::vector<int>& slots) -> bool {
+  long n = keys.size();
+  if (mpark::holds_alternative<PyInt>(*keys.front())) {
+    auto low = mpark::get<PyInt>(*keys.front()).value;
+    auto high = low;
+    for (auto&& key : keys) {
+      low = std::min(low, mpark::get<PyInt>(*key).value);
+      high = std::max(high, mpark::get<PyInt>(*key).value);
+    }
+    // At least half full.
+    if (high - low < 2 * n) {
+      table.low = low;
+      table.dense.assign(high - low + 1, -1);
+      for (auto&& key : keys) {
+        slots.push_back(mpark::get<PyInt>(*key).value - low);
+      }
+      return true;
+    }
+  }
+
+  std::vector<std::size_t> hashes;
+  for (auto&& key : keys) hashes.push_back(hash(*key));
+  std::size_t smallest = 1;
+  while (smallest < keys.size()) smallest *= 2;
+  for (auto size = smallest; size <= smallest * max_hash_spread; size *= 2) {
+    for (int shift = 0; shift < 64; ++shift) {
+      std::vector<bool> used(size);
+      slots.clear();
+      for (auto h : hashes) {
+        auto slot = (h >> shift) & (size - 1);
+        if (used[slot]) break;
+        used[slot] = true;
+        slots.push_back(slot);
+      }
+      if (slots.size() == keys.size()) {
+        table.shift = shift;
+        table.keys.assign(size, nullptr);
+        table.targets.assign(size, -1);
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+          table.keys[slots[i]] = keys[i];
+        }
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Compiles an if/elif chain that compares one name with distinct int or
+// string literals into a single jump through a table, rather than a compare
+// per case. Returns false, having emitted nothing, if the chain is too short
+// or does not have that form.
+auto compile_jump_table(If const& if_stmt, Code& code) -> bool {
+  std::string name;
+  std::vector<If const*> cases;
+  std::vector<std::shared_ptr<PyObj>> keys;
+  auto link = &if_stmt;
+  while (link != nullptr) {
+    std::string subject;
+    auto key = case_key(*link->test, subject);
+    if (!key || (!keys.empty() && (subject != name ||
+                                   key->index() != keys.front()->index()))) {
+      break;
+    }
+    // The chain ends before a repeated literal, whose case can only run
+    // if the name changes in between.
+    bool repeated = false;
+    for (auto&& other : keys) repeated = repeated || equal(*other, *key);
+    if (repeated) break;
+
+    name = subject;
+    cases.push_back(link);
+    keys.push_back(std::move(key));
+    link = link->or_else.size() == 1 ? mpark::get_if<If>(&link->or_else[0])
+                                     : nullptr;
+  }
+  if (cases.size() < min_jump_table_cases) return false;
+
+  JumpTable table;
+  table.first = keys.front();
+  std::vector<int> slots;
+  if (!plan_jump_table(keys, table, slots)) return false;
+
+  emit_load(code, name);
+  int index = code.jump_tables.size();
+  emit(code, OpCode::jump_table, index);
+  // Reserved now, as the bodies may add tables of their own.
+  code.jump_tables.emplace_back();
+
+  std::vector<int> to_end;
+  for (std::size_t i = 0; i < cases.size(); ++i) {
+    auto& targets = table.dense.empty() ? table.targets : table.dense;
+    targets[slots[i]] = code.instrs.size();
+    compile_body(cases[i]->body, code);
+    to_end.push_back(emit(code, OpCode::jump));
+  }
+  table.default_target = code.instrs.size();
+  compile_body(cases.back()->or_else, code);
+  for (auto jump : to_end) code.instrs[jump].arg = code.instrs.size();
+  code.jump_tables[index] = std::move(table);
+  return true;
+}
+
+void compile_stmt(Statement const& stmt, Code& code) {
+  auto visitor = Util::make_visitor(
+      [&](FunctionDef const& def) {
+        auto fun = compile(def);
+        std::vector<int> captures;
+        if (code.scope) {
+          for (auto&& name : fun->scope->free) {
+            captures.push_back(slot_of_name(code, name));
+          }
+        }
+
+        code.defs.push_back(def);
+        code.functions.push_back(fun);
+        code.captures.push_back(captures);
+        emit(code, OpCode::make_function, code.functions.size() - 1);
+        emit_store(code, def.name);
+      },
+      [&](Return const& ret) {
+        if (ret.value) {
+          compile_expr(*ret.value, code);
+        } else {
+          emit(code, OpCode::load_const, add_const(code, PyNoneType()));
+        }
+        emit(code, OpCode::return_value);
+      },
+      [&](Assign const& assign) {
+        if (assign.targets.empty()) throw "Assignment without a target";
+        if (assign.targets.size() == 1 &&
+            compile_unpack_literal(assign.targets.front(), *assign.value,
+                                   code)) {
+          return;
+        }
+        // `a = b = x` stores one value into each target, left to right.
+        compile_expr(*assign.value, code);
+        for (std::size_t i = 0; i + 1 < assign.targets.size(); ++i) {
+          emit(code, OpCode::dup_top);
+          emit_target(assign.targets[i], code);
+        }
+        emit_target(assign.targets.back(), code);
+      },
+      [&](AugAssign const& aug) {
+        auto op = static_cast<int>(aug.op);
+        if (auto name = mpark::get_if<Name>(aug.target.get())) {
+          compile_expr(*aug.value, code);
+          // The binding is updated where it lives, so that a value nothing
+          // else holds can change in place.
+          auto slot = slot_of_name(code, name->id);
+          if (slot < 0) {
+            emit(code, OpCode::inplace_global,
+                 add_name(code, name->id) << 4 | op);
+          } else if (is_cell(*code.scope, name->id)) {
+            emit(code, OpCode::inplace_deref, slot << 4 | op);
+          } else {
+            emit(code, OpCode::inplace_fast, slot << 4 | op);
+          }
+        } else if (auto sub = mpark::get_if<Subscript>(aug.target.get())) {
+          compile_expr(*sub->value, code);
+          compile_expr(*sub->index, code);
+          compile_expr(*aug.value, code);
+          emit(code, OpCode::inplace_subscr, op);
+        } else {
+          throw "Illegal expression for augmented assignment";
+        }
+      },
+      [&](If const& if_stmt) {
+        if (compile_jump_table(if_stmt, code)) return;
+        compile_expr(*if_stmt.test, code);
+        auto to_else = emit(code, OpCode::jump_if_false);
+        compile_body(if_stmt.body, code);
+        if (if_stmt.or_else.empty()) {
+          code.instrs[to_else].arg = code.instrs.size();
+        } else {
+          auto to_end = emit(code, OpCode::jump);
+          code.instrs[to_else].arg = code.instrs.size();
+          compile_body(if_stmt.or_else, code);
+          code.instrs[to_end].arg = code.instrs.size();
+        }
+      },
+      [&](While const& loop) {
+        int top = code.instrs.size();
+        compile_expr(*loop.test, code);
+        auto to_else = emit(code, OpCode::jump_if_false);
+        compile_body(loop.body, code);
+        emit(code, OpCode::jump, top);
+        code.instrs[to_else].arg = code.instrs.size();
+        compile_body(loop.or_else, code);
+      },
+      [&](For const& loop) {
+        auto slot = fast_slot(code, *loop.target);
+        if (slot >= 0 && range_args(*loop.iter) != nullptr) {
+          compile_counted_loop(loop, slot, code);
+          return;
+        }
+        compile_expr(*loop.iter, code);
+        emit(code, OpCode::get_iter);
+        int top = emit(code, OpCode::for_iter);
+        emit_target(*loop.target, code);
+        compile_body(loop.body, code);
+        emit(code, OpCode::jump, top);
+        code.instrs[top].arg = code.instrs.size();
+        compile_body(loop.or_else, code);
+      },
+      [&](Expr const& expr) {
+        compile_expr(*expr.value, code);
+        emit(code, OpCode::pop_top);
+      },
+      [&](Print const& print) {
+        auto file = add_file(code, print.file);
+        for (int i = 0; i < print.objects.size(); ++i) {
+          if (i > 0) emit(code, OpCode::print_space, file);
+          compile_expr(print.objects[i], code);
+          emit(code, OpCode::print_item, file);
+        }
+        emit(code, OpCode::print_newline, file);
+      });
+  mpark::visit(visitor, stmt);
+}
+}  // namespace
+
+auto compile(Module const& ast) -> std::shared_ptr<Code const> {
+  auto code = std::make_shared<Code>();
+  compile_body(ast.body, *code);
+  return code;
+}
+
+auto compile(FunctionDef const& def) -> std::shared_ptr<Code const> {
+  auto code = std::make_shared<Code>();
+  code->name = def.name;
+  code->scope = std::make_shared<Scope const>(resolve_scope(def));
+  code->nlocals = code->scope->locals.size();
+  code->nslots = code->nlocals + code->scope->free.size();
+  for (auto&& name : code->scope->cells) {
+    code->cell_slots.push_back(slot_of(*code->scope, name));
+  }
+  compile_body(def.body, *code);
+  emit(*code, OpCode::load_const, add_const(*code, PyNoneType()));
+  emit(*code, OpCode::return_value);
+  return code;
+}
+}  // namespace MyPython
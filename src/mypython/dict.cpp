@@ -0,0 +1,285 @@
+#include <mypython/ast.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+#include <mypython/bigint.hpp>
+
+namespace MyPython {
+namespace {
+// Numbers hash to their value modulo this Mersenne prime, as in CPython, so
+// that ints, bools and floats that compare equal hash equally.
+constexpr std::uint64_t modulus = (1ULL << 61) - 1;
+constexpr int modulus_bits = 61;
+// The hash of None, which is equal only to itself.
+constexpr std::size_t none_hash = 0x5bd1e995;
+
+auto signed_hash(std::uint64_t magnitude, bool negative) -> std::size_t {
+  long h = static_cast<long>(magnitude);
+  if (negative) h = -h;
+  // -1 is reserved by CPython, which this matches.
+  if (h == -1) h = -2;
+  return static_cast<std::size_t>(h);
+}
+
+auto hash_int(PyInt const& i) -> std::size_t {
+  if (!i.big) {
+    auto magnitude = i.value < 0 ? 0 - static_cast<std::uint64_t>(i.value)
+                                 : static_cast<std::uint64_t>(i.value);
+    return signed_hash(magnitude % modulus, i.value < 0);
+  }
+  unsigned __int128 h = 0;
+  auto const& limbs = i.big->limbs;
+  for (auto it = limbs.rbegin(); it != limbs.rend(); ++it) {
+    h = ((h << 32) | *it) % modulus;
+  }
+  return signed_hash(static_cast<std::uint64_t>(h), i.big->negative);
+}
+
+// Rotates x left by n bits within the modulus's 61 bits.
+auto rotate(std::uint64_t x, int n) -> std::uint64_t {
+  return ((x << n) & modulus) | x >> (modulus_bits - n);
+}
+
+// CPython's float hash: the value's fraction is reduced modulo the prime 28
+// bits at a time, and its exponent becomes a rotation.
+auto hash_float(double value) -> std::size_t {
+  if (std::isinf(value)) return signed_hash(314159, value < 0);
+  if (std::isnan(value)) return 0;
+
+  int exp = 0;
+  auto m = std::frexp(value, &exp);
+  bool negative = m < 0;
+  if (negative) m = -m;
+
+  std::uint64_t x = 0;
+  while (m != 0) {
+    x = rotate(x, 28);
+    m *= 268435456.0;
+    exp -= 28;
+    auto y = static_cast<std::uint64_t>(m);
+    m -= y;
+    x += y;
+    if (x >= modulus) x -= modulus;
+  }
+  exp = exp >= 0 ? exp % modulus_bits
+                 : modulus_bits - 1 - ((-1 - exp) % modulus_bits);
+  return signed_hash(rotate(x, exp), negative);
+}
+
+// Index slots are signed integers of the table's width, with -1 for empty.
+constexpr long empty_slot = -1;
+
+template <class T>
+auto load_slot(unsigned char const* index, std::size_t slot) -> long {
+  T value;
+  std::memcpy(&value, index + slot * sizeof(T), sizeof(T));
+  return value;
+}
+
+template <class T>
+void store_slot(unsigned char* index, std::size_t slot, long value) {
+  auto narrow = static_cast<T>(value);
+  std::memcpy(index + slot * sizeof(T), &narrow, sizeof(T));
+}
+
+// Probes as CPython does, mixing in the hash's high bits so that keys whose
+// low bits collide still spread out.
+template <class T, class Match>
+auto probe(unsigned char const* index, std::size_t mask, std::size_t hash,
+           Match match, std::size_t& slot) -> long {
+  auto perturb = hash;
+  auto i = hash & mask;
+  while (true) {
+    auto entry = load_slot<T>(index, i);
+    if (entry == empty_slot) {
+      slot = i;
+      return -1;
+    }
+    if (match(entry)) return entry;
+    perturb >>= 5;
+    i = (i * 5 + perturb + 1) & mask;
+  }
+}
+
+// The narrowest slot that can address every entry of a table of this size.
+auto width_for(std::size_t slots) -> int {
+  if (slots <= 0x80) return 1;
+  if (slots <= 0x8000) return 2;
+  if (slots <= 0x80000000) return 4;
+  return 8;
+}
+
+// A table may fill to two thirds before it grows.
+auto usable(std::size_t slots) -> std::size_t { return slots * 2 / 3; }
+
+constexpr std::size_t min_slots = 8;
+
+// CPython's tuple hash, a reduced xxHash over the element hashes.
+auto hash_tuple(PyTuple const& t) -> std::size_t {
+  std::uint64_t const prime1 = 11400714785074694791ULL;
+  std::uint64_t const prime2 = 14029467366897019727ULL;
+  std::uint64_t const prime5 = 2870177450012600261ULL;
+  auto acc = prime5;
+  for (auto&& item : t) {
+    acc += hash(*item) * prime2;
+    acc = (acc << 31) | (acc >> 33);
+    acc *= prime1;
+  }
+  acc += t.size() ^ (prime5 ^ 3527539ULL);
+  if (acc == static_cast<std::uint64_t>(-1)) return 1546275796;
+  return acc;
+}
+}  // namespace
+
+auto hash(PyObj const& obj) -> std::size_t {
+  if (auto s = mpark::get_if<PyStr>(&obj)) return s->hash();
+  if (auto i = mpark::get_if<PyInt>(&obj)) return hash_int(*i);
+  if (auto b = mpark::get_if<PyBool>(&obj)) return hash_int(*b);
+  if (auto f = mpark::get_if<PyFloat>(&obj)) return hash_float(f->value);
+  if (mpark::holds_alternative<PyNoneType>(obj)) return none_hash;
+  if (auto t = mpark::get_if<PyTuple>(&obj)) return hash_tuple(*t);
+  if (mpark::holds_alternative<PyList>(obj) ||
+      mpark::holds_alternative<PyDict>(obj)) {
+    throw "Unhashable type";
+  }
+  // Everything else is equal only to itself.
+  return std::hash<void const*>()(&obj);
+}
+
+auto PyDict::get(PyObj const& key) const -> std::shared_ptr<PyObj> {
+  if (entries_.empty()) return nullptr;
+  auto h = hash(key);
+  // A string key equals nothing but a string.
+  if (str_keys_ && !mpark::holds_alternative<PyStr>(key)) return nullptr;
+  std::size_t slot = 0;
+  auto entry = find(key, h, slot);
+  return entry < 0 ? nullptr : entries_[entry].value;
+}
+
+auto PyDict::lookup(PyObj const& key) -> std::shared_ptr<PyObj>* {
+  if (entries_.empty()) return nullptr;
+  auto h = hash(key);
+  if (str_keys_ && !mpark::holds_alternative<PyStr>(key)) return nullptr;
+  std::size_t slot = 0;
+  auto entry = find(key, h, slot);
+  return entry < 0 ? nullptr : &entries_[entry].value;
+}
+
+void PyDict::set(std::shared_ptr<PyObj> key, std::shared_ptr<PyObj> value) {
+  auto h = hash(*key);
+  std::size_t slot = 0;
+  if (!index_.empty()) {
+    auto entry = find(*key, h, slot);
+    if (entry >= 0) {
+      entries_[entry].value = std::move(value);
+      return;
+    }
+  }
+
+  auto slots = index_.size() / width_;
+  if (entries_.size() + 1 > usable(slots)) {
+    // Grow to three times the entries, as CPython does.
+    auto target = min_slots;
+    while (target < (entries_.size() + 1) * 3) target *= 2;
+    resize(target);
+    find(*key, h, slot);
+  }
+
+  str_keys_ = str_keys_ && mpark::holds_alternative<PyStr>(*key);
+  Entry entry;
+  entry.hash = h;
+  entry.key = std::move(key);
+  entry.value = std::move(value);
+  switch (width_) {
+    case 1:
+      store_slot<std::int8_t>(index_.data(), slot, entries_.size());
+      break;
+    case 2:
+      store_slot<std::int16_t>(index_.data(), slot, entries_.size());
+      break;
+    case 4:
+      store_slot<std::int32_t>(index_.data(), slot, entries_.size());
+      break;
+    default:
+      store_slot<std::int64_t>(index_.data(), slot, entries_.size());
+      break;
+  }
+  entries_.push_back(std::move(entry));
+}
+
+auto PyDict::find(PyObj const& key, std::size_t hash, std::size_t& slot) const
+    -> long {
+  auto mask = index_.size() / width_ - 1;
+  auto index = index_.data();
+  auto entries = entries_.data();
+
+  auto s = mpark::get_if<PyStr>(&key);
+  if (str_keys_ && s != nullptr) {
+    auto match = [&](long entry) {
+      auto const& e = entries[entry];
+      if (e.hash != hash) return false;
+      return equal(*mpark::get_if<PyStr>(e.key.get()), *s);
+    };
+    switch (width_) {
+      case 1:
+        return probe<std::int8_t>(index, mask, hash, match, slot);
+      case 2:
+        return probe<std::int16_t>(index, mask, hash, match, slot);
+      case 4:
+        return probe<std::int32_t>(index, mask, hash, match, slot);
+      default:
+        return probe<std::int64_t>(index, mask, hash, match, slot);
+    }
+  }
+
+  auto match = [&](long entry) {
+    auto const& e = entries[entry];
+    return e.hash == hash && (e.key.get() == &key || equal(*e.key, key));
+  };
+  switch (width_) {
+    case 1:
+      return probe<std::int8_t>(index, mask, hash, match, slot);
+    case 2:
+      return probe<std::int16_t>(index, mask, hash, match, slot);
+    case 4:
+      return probe<std::int32_t>(index, mask, hash, match, slot);
+    default:
+      return probe<std::int64_t>(index, mask, hash, match, slot);
+  }
+}
+
+void PyDict::resize(std::size_t slots) {
+  width_ = width_for(slots);
+  // Every byte 0xff reads as -1, the empty slot, at any width.
+  index_.assign(slots * width_, 0xff);
+  entries_.reserve(usable(slots));
+
+  auto mask = slots - 1;
+  for (std::size_t entry = 0; entry < entries_.size(); ++entry) {
+    // No key is equal to another, so only an empty slot is ever found.
+    auto no_match = [](long) { return false; };
+    std::size_t slot = 0;
+    auto hash = entries_[entry].hash;
+    switch (width_) {
+      case 1:
+        probe<std::int8_t>(index_.data(), mask, hash, no_match, slot);
+        store_slot<std::int8_t>(index_.data(), slot, entry);
+        break;
+      case 2:
+        probe<std::int16_t>(index_.data(), mask, hash, no_match, slot);
+        store_slot<std::int16_t>(index_.data(), slot, entry);
+        break;
+      case 4:
+        probe<std::int32_t>(index_.data(), mask, hash, no_match, slot);
+        store_slot<std::int32_t>(index_.data(), slot, entry);
+        break;
+      default:
+        probe<std::int64_t>(index_.data(), mask, hash, no_match, slot);
+        store_slot<std::int64_t>(index_.data(), slot, entry);
+        break;
+    }
+  }
+}
+}  // namespace MyPython
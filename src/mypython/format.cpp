@@ -0,0 +1,343 @@
+#include <mypython/format.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#include <mypython/bigint.hpp>
+
+namespace MyPython {
+namespace {
+using u128 = unsigned __int128;
+
+constexpr int mantissa_bits = 52;
+constexpr int exponent_bits = 11;
+constexpr int bias = 1023;
+
+// Powers of five are held as 125-bit fixed-point values.
+constexpr int pow5_inv_bitcount = 125;
+constexpr int pow5_bitcount = 125;
+constexpr int pow5_inv_table_size = 342;
+constexpr int pow5_table_size = 326;
+
+// ceil(log2(5^e)), or 1 for e == 0. Exact for 0 <= e <= 3528.
+auto pow5bits(int e) -> int {
+  return static_cast<int>((static_cast<std::uint32_t>(e) * 1217359) >> 19) + 1;
+}
+
+// floor(log10(2^e)). Exact for 0 <= e <= 1650.
+auto log10_pow2(int e) -> int {
+  return static_cast<int>((static_cast<std::uint32_t>(e) * 78913) >> 18);
+}
+
+// floor(log10(5^e)). Exact for 0 <= e <= 2620.
+auto log10_pow5(int e) -> int {
+  return static_cast<int>((static_cast<std::uint32_t>(e) * 732923) >> 20);
+}
+
+auto low_bits(BigInt const& a) -> u128 {
+  u128 result = 0;
+  for (auto i = std::min<std::size_t>(a.limbs.size(), 4); i-- > 0;) {
+    result = (result << 32) | a.limbs[i];
+  }
+  return result;
+}
+
+struct Pow5Tables {
+  // inv[q] ~ 2^(pow5bits(q) - 1 + 125) / 5^q, rounded up.
+  std::array<u128, pow5_inv_table_size> inv = {};
+  // pow[i] ~ 5^i * 2^(125 - pow5bits(i)), rounded down.
+  std::array<u128, pow5_table_size> pow = {};
+};
+
+// Derives the tables from exact powers of five instead of carrying them as
+// literals.
+auto make_tables() -> Pow5Tables {
+  Pow5Tables tables;
+  auto const one = make_bigint(1);
+  auto const five = make_bigint(5);
+
+  auto p = one;
+  for (int q = 0; q < pow5_inv_table_size; ++q, p = mul(p, five)) {
+    auto scale = lshift(one, pow5bits(q) - 1 + pow5_inv_bitcount);
+    tables.inv[q] = low_bits(add(floor_div(scale, p), one));
+  }
+
+  p = one;
+  for (int i = 0; i < pow5_table_size; ++i, p = mul(p, five)) {
+    auto shift = pow5bits(i) - pow5_bitcount;
+    tables.pow[i] = low_bits(shift > 0 ? rshift(p, shift) : lshift(p, -shift));
+  }
+  return tables;
+}
+
+auto const tables = make_tables();
+
+// (m * mul) >> j, for m of at most 55 bits and j >= 64.
+auto mul_shift(std::uint64_t m, u128 mul, int j) -> std::uint64_t {
+  auto low = static_cast<u128>(m) * static_cast<std::uint64_t>(mul);
+  auto high = static_cast<u128>(m) * static_cast<std::uint64_t>(mul >> 64);
+  return static_cast<std::uint64_t>(((low >> 64) + high) >> (j - 64));
+}
+
+auto pow5_factor(std::uint64_t value) -> int {
+  int count = 0;
+  for (; value % 5 == 0; value /= 5) ++count;
+  return count;
+}
+
+auto multiple_of_pow5(std::uint64_t value, int p) -> bool {
+  return pow5_factor(value) >= p;
+}
+
+auto multiple_of_pow2(std::uint64_t value, int p) -> bool {
+  return (value & ((1ULL << p) - 1)) == 0;
+}
+
+// mantissa * 10^exponent
+struct Decimal {
+  std::uint64_t mantissa = 0;
+  int exponent = 0;
+};
+
+// Finds the shortest decimal in the interval of reals that round to the
+// double, taking the one nearest the exact value.
+auto to_decimal(std::uint64_t ieee_mantissa, int ieee_exponent) -> Decimal {
+  // The value is m2 * 2^e2, with two extra bits to hold the halfway points
+  // to its neighbours.
+  int e2 = 0;
+  std::uint64_t m2 = 0;
+  if (ieee_exponent == 0) {
+    e2 = 1 - bias - mantissa_bits - 2;
+    m2 = ieee_mantissa;
+  } else {
+    e2 = ieee_exponent - bias - mantissa_bits - 2;
+    m2 = (1ULL << mantissa_bits) | ieee_mantissa;
+  }
+  bool const accept_bounds = (m2 & 1) == 0;
+
+  // The interval is [mm, mp] around mv, in units of 2^e2. The gap below is
+  // half as wide at the bottom of a binade.
+  std::uint64_t const mv = 4 * m2;
+  int const mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+
+  // Scale all three by a power of ten, so that vr, vp and vm are the interval
+  // in units of 10^e10.
+  std::uint64_t vr = 0;
+  std::uint64_t vp = 0;
+  std::uint64_t vm = 0;
+  int e10 = 0;
+  bool vm_trailing_zeros = false;
+  bool vr_trailing_zeros = false;
+  if (e2 >= 0) {
+    int const q = log10_pow2(e2) - (e2 > 3);
+    e10 = q;
+    int const k = pow5_inv_bitcount + pow5bits(q) - 1;
+    int const i = -e2 + q + k;
+    vr = mul_shift(4 * m2, tables.inv[q], i);
+    vp = mul_shift(4 * m2 + 2, tables.inv[q], i);
+    vm = mul_shift(4 * m2 - 1 - mm_shift, tables.inv[q], i);
+    if (q <= 21) {
+      // Only one of mp, mv and mm can be a multiple of 5.
+      if (mv % 5 == 0) {
+        vr_trailing_zeros = multiple_of_pow5(mv, q);
+      } else if (accept_bounds) {
+        vm_trailing_zeros = multiple_of_pow5(mv - 1 - mm_shift, q);
+      } else {
+        vp -= multiple_of_pow5(mv + 2, q);
+      }
+    }
+  } else {
+    int const q = log10_pow5(-e2) - (-e2 > 1);
+    e10 = q + e2;
+    int const i = -e2 - q;
+    int const k = pow5bits(i) - pow5_bitcount;
+    int const j = q - k;
+    vr = mul_shift(4 * m2, tables.pow[i], j);
+    vp = mul_shift(4 * m2 + 2, tables.pow[i], j);
+    vm = mul_shift(4 * m2 - 1 - mm_shift, tables.pow[i], j);
+    if (q <= 1) {
+      // mv has at least two trailing zero bits, and mp at least one.
+      vr_trailing_zeros = true;
+      if (accept_bounds) {
+        vm_trailing_zeros = mm_shift == 1;
+      } else {
+        --vp;
+      }
+    } else if (q < 63) {
+      vr_trailing_zeros = multiple_of_pow2(mv, q);
+    }
+  }
+
+  // Drop digits while the interval still holds a shorter decimal.
+  int removed = 0;
+  int last_removed = 0;
+  std::uint64_t output = 0;
+  if (vm_trailing_zeros || vr_trailing_zeros) {
+    // The exact digits matter for rounding and for the lower bound.
+    while (vp / 10 > vm / 10) {
+      vm_trailing_zeros &= vm % 10 == 0;
+      vr_trailing_zeros &= last_removed == 0;
+      last_removed = vr % 10;
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      ++removed;
+    }
+    if (vm_trailing_zeros) {
+      while (vm % 10 == 0) {
+        vr_trailing_zeros &= last_removed == 0;
+        last_removed = vr % 10;
+        vr /= 10;
+        vp /= 10;
+        vm /= 10;
+        ++removed;
+      }
+    }
+    // Round half to even when the exact value ends in 50...0.
+    if (vr_trailing_zeros && last_removed == 5 && vr % 2 == 0) {
+      last_removed = 4;
+    }
+    output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) ||
+                   last_removed >= 5);
+  } else {
+    bool round_up = false;
+    if (vp / 100 > vm / 100) {
+      round_up = vr % 100 >= 50;
+      vr /= 100;
+      vp /= 100;
+      vm /= 100;
+      removed += 2;
+    }
+    while (vp / 10 > vm / 10) {
+      round_up = vr % 10 >= 5;
+      vr /= 10;
+      vp /= 10;
+      vm /= 10;
+      ++removed;
+    }
+    output = vr + (vr == vm || round_up);
+  }
+
+  Decimal result;
+  result.mantissa = output;
+  result.exponent = e10 + removed;
+  return result;
+}
+
+constexpr char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536"
+    "37383940414243444546474849505152535455565758596061626364656667686970717273"
+    "7475767778798081828384858687888990919293949596979899";
+
+// Writes value so that its last digit lands just before end, and returns the
+// start of the digits.
+auto write_backward(std::uint64_t value, char* end) -> char* {
+  while (value >= 100) {
+    auto pair = static_cast<unsigned>(value % 100) * 2;
+    value /= 100;
+    end -= 2;
+    std::memcpy(end, digit_pairs + pair, 2);
+  }
+  if (value >= 10) {
+    end -= 2;
+    std::memcpy(end, digit_pairs + value * 2, 2);
+  } else {
+    *--end = static_cast<char>('0' + value);
+  }
+  return end;
+}
+
+auto count_digits(std::uint64_t value) -> int {
+  int n = 1;
+  for (; value >= 10000; value /= 10000) n += 4;
+  return n + (value >= 10) + (value >= 100) + (value >= 1000);
+}
+
+auto copy(char const* s, char* out) -> char* {
+  auto n = std::strlen(s);
+  std::memcpy(out, s, n);
+  return out + n;
+}
+}  // namespace
+
+auto format_float(double value, char* out) -> char* {
+  std::uint64_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+  bool const negative = (bits >> 63) != 0;
+  auto const ieee_mantissa = bits & ((1ULL << mantissa_bits) - 1);
+  auto const ieee_exponent = static_cast<int>(
+      (bits >> mantissa_bits) & ((1U << exponent_bits) - 1));
+
+  if (ieee_exponent == (1 << exponent_bits) - 1) {
+    if (ieee_mantissa != 0) return copy("nan", out);
+    return copy(negative ? "-inf" : "inf", out);
+  }
+  if (negative) *out++ = '-';
+  if (ieee_exponent == 0 && ieee_mantissa == 0) return copy("0.0", out);
+
+  auto decimal = to_decimal(ieee_mantissa, ieee_exponent);
+  char digits[20];
+  int const n = count_digits(decimal.mantissa);
+  write_backward(decimal.mantissa, digits + n);
+
+  // Python switches to exponent notation outside 1e-5 <= |value| < 1e16.
+  int const point = n + decimal.exponent;
+  if (point <= -4 || point > 16) {
+    *out++ = digits[0];
+    if (n > 1) {
+      *out++ = '.';
+      out = std::copy(digits + 1, digits + n, out);
+    }
+    *out++ = 'e';
+    int exp = point - 1;
+    *out++ = exp < 0 ? '-' : '+';
+    exp = exp < 0 ? -exp : exp;
+    if (exp >= 100) *out++ = '0' + exp / 100;
+    *out++ = '0' + exp / 10 % 10;
+    *out++ = '0' + exp % 10;
+  } else if (point <= 0) {
+    out = copy("0.", out);
+    out = std::fill_n(out, -point, '0');
+    out = std::copy(digits, digits + n, out);
+  } else if (point >= n) {
+    out = std::copy(digits, digits + n, out);
+    out = std::fill_n(out, point - n, '0');
+    out = copy(".0", out);
+  } else {
+    out = std::copy(digits, digits + point, out);
+    *out++ = '.';
+    out = std::copy(digits + point, digits + n, out);
+  }
+  return out;
+}
+
+auto format_float(double value) -> std::string {
+  char buffer[float_chars];
+  return std::string(buffer, format_float(value, buffer));
+}
+
+auto format_int(long value, char* out) -> char* {
+  // Negate in unsigned arithmetic so that LONG_MIN does not overflow.
+  auto mag = static_cast<std::uint64_t>(value);
+  if (value < 0) {
+    *out++ = '-';
+    mag = 0 - mag;
+  }
+  out += count_digits(mag);
+  write_backward(mag, out);
+  return out;
+}
+
+auto format_int(long value) -> std::string {
+  char buffer[int_chars];
+  return std::string(buffer, format_int(value, buffer));
+}
+
+auto format_padded(std::uint64_t value, int width, char* out) -> char* {
+  auto end = out + width;
+  std::fill(out, write_backward(value, end), '0');
+  return end;
+}
+}  // namespace MyPython
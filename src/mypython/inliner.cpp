@@ -0,0 +1,492 @@
+#include <mypython/inliner.hpp>
+
+#include <utility>
+#include <vector>
+
+#include <mypython/scope.hpp>
+#include <util/variant.hpp>
+
+namespace MyPython {
+namespace {
+using Renames = std::map<std::string, Expression>;
+
+struct Candidate {
+  FunctionDef def = {};
+  Scope scope = {};
+  int size = 0;
+};
+
+struct Caller {
+  std::string name = "<module>";
+  // Scopes of the enclosing functions, innermost last. Empty at module level.
+  std::vector<Scope const*> scopes = {};
+};
+
+struct Inliner {
+  InlineOptions options = {};
+  InlineReport* report = nullptr;
+  std::map<std::string, Candidate> candidates = {};
+  std::map<std::string, int> module_bindings = {};
+  int fresh = 0;
+};
+
+// Calls visit on root and then on each node below it that the inliner looks
+// into, from an explicit stack so that the depth of an expression tree never
+// reaches the native stack. Stops as soon as visit returns false.
+template <class F>
+void visit_nodes(Expression const& root, F visit) {
+  std::vector<Expression const*> pending = {&root};
+  auto push = [&](Expression const& expr) { pending.push_back(&expr); };
+  auto push_all = [&](std::vector<Expression> const& exprs) {
+    for (auto it = exprs.rbegin(); it != exprs.rend(); ++it) push(*it);
+  };
+
+  auto children = Util::make_visitor(
+      [&](BoolOp const& op) {
+        push(*op.right);
+        push(*op.left);
+      },
+      [&](BinOp const& op) {
+        push(*op.right);
+        push(*op.left);
+      },
+      [&](Call const& call) {
+        push_all(call.args);
+        push(*call.func);
+      },
+      [&](Compare const& cmp) {
+        push_all(cmp.comparators);
+        push(*cmp.left);
+      },
+      [](auto const&) {});
+
+  while (!pending.empty()) {
+    auto expr = pending.back();
+    pending.pop_back();
+    if (!visit(*expr)) return;
+    mpark::visit(children, *expr);
+  }
+}
+
+// Counts the nodes of expr, stopping once the count passes limit.
+auto size_of(Expression const& expr, int limit) -> int {
+  int size = 0;
+  visit_nodes(expr, [&](Expression const&) { return ++size <= limit; });
+  return size;
+}
+
+auto contains_call(Expression const& expr) -> bool {
+  bool found = false;
+  visit_nodes(expr, [&](Expression const& node) {
+    found = mpark::holds_alternative<Call>(node);
+    return !found;
+  });
+  return found;
+}
+
+auto is_trivial(Expression const& expr) -> bool {
+  return mpark::holds_alternative<Name>(expr) ||
+         mpark::holds_alternative<Num>(expr) ||
+         mpark::holds_alternative<Str>(expr) ||
+         mpark::holds_alternative<NameConstant>(expr);
+}
+
+// Whether substitute can rewrite every node of expr.
+auto substitutable(Expression const& expr) -> bool {
+  bool ok = true;
+  visit_nodes(expr, [&](Expression const& node) {
+    ok = is_trivial(node) || mpark::holds_alternative<BoolOp>(node) ||
+         mpark::holds_alternative<BinOp>(node) ||
+         mpark::holds_alternative<Compare>(node);
+    return ok;
+  });
+  return ok;
+}
+
+// Rebuilds a callee expression with its locals replaced. Clears ok when the
+// expression holds a construct that cannot be rewritten. Copies each node
+// before rewriting it in place, from an explicit stack like visit_nodes.
+auto substitute(Expression const& expr, Renames const& renames, bool& ok)
+    -> Expression {
+  Expression result = expr;
+  std::vector<Expression*> pending = {&result};
+  auto copy = [&](std::shared_ptr<Expression>& child) {
+    child = std::make_shared<Expression>(*child);
+    pending.push_back(child.get());
+  };
+
+  auto visitor = Util::make_visitor(
+      [&](BoolOp& op) {
+        copy(op.left);
+        copy(op.right);
+      },
+      [&](BinOp& op) {
+        copy(op.left);
+        copy(op.right);
+      },
+      [&](Compare& cmp) {
+        copy(cmp.left);
+        for (auto&& comparator : cmp.comparators) {
+          pending.push_back(&comparator);
+        }
+      },
+      [](Num const&) {},
+      [](Str const&) {},
+      [](NameConstant const&) {},
+      [&](auto const&) { ok = false; });
+
+  while (!pending.empty()) {
+    auto node = pending.back();
+    pending.pop_back();
+    if (auto name = mpark::get_if<Name>(node)) {
+      auto it = renames.find(name->id);
+      if (it != renames.end()) *node = it->second;
+    } else {
+      mpark::visit(visitor, *node);
+    }
+  }
+  return result;
+}
+
+// Returns the reason def cannot be inlined, or an empty string if it can.
+auto check_candidate(FunctionDef const& def, Inliner const& inliner,
+                     Candidate& candidate) -> std::string {
+  if (inliner.module_bindings.at(def.name) != 1) {
+    return "rebound at module level";
+  }
+  if (def.body.empty()) return "empty body";
+
+  candidate.def = def;
+  candidate.scope = resolve_scope(def);
+  candidate.size = 0;
+
+  bool calls = false;
+  bool ok = true;
+  for (int i = 0; i < def.body.size(); ++i) {
+    Expression const* value = nullptr;
+    bool last = i + 1 == def.body.size();
+    if (auto assign = mpark::get_if<Assign>(&def.body[i])) {
+      if (last || assign->targets.size() != 1 ||
+          !mpark::holds_alternative<Name>(assign->targets.front())) {
+        return "body is not straight-line";
+      }
+      value = assign->value.get();
+    } else if (auto ret = mpark::get_if<Return>(&def.body[i])) {
+      if (!last || !ret->value) return "body is not straight-line";
+      value = ret->value.get();
+    } else {
+      return "body is not straight-line";
+    }
+
+    auto const max_size = inliner.options.max_size;
+    candidate.size += 1 + size_of(*value, max_size - candidate.size - 1);
+    calls = calls || contains_call(*value);
+    ok = ok && substitutable(*value);
+  }
+
+  if (calls) {
+    return is_free(candidate.scope, def.name) ? "recursive" : "not a leaf";
+  }
+  if (!ok) return "unsupported construct";
+  if (candidate.size > inliner.options.max_size) {
+    return "too large (over " + std::to_string(inliner.options.max_size) +
+           " nodes)";
+  }
+  return "";
+}
+
+void count_target(Expression const& target, int times,
+                  std::map<std::string, int>& bindings) {
+  if (auto name = mpark::get_if<Name>(&target)) {
+    bindings[name->id] += times;
+  } else if (auto tuple = mpark::get_if<Tuple>(&target)) {
+    for (auto&& elt : tuple->elts) count_target(elt, times, bindings);
+  }
+}
+
+void count_bindings(std::vector<Statement> const& body,
+                    std::map<std::string, int>& bindings) {
+  for (auto&& stmt : body) {
+    auto visitor = Util::make_visitor(
+        [&](FunctionDef const& def) { ++bindings[def.name]; },
+        [&](Assign const& assign) {
+          for (auto&& target : assign.targets) {
+            count_target(target, 1, bindings);
+          }
+        },
+        [&](AugAssign const& aug) { count_target(*aug.target, 1, bindings); },
+        [&](If const& if_stmt) {
+          count_bindings(if_stmt.body, bindings);
+          count_bindings(if_stmt.or_else, bindings);
+        },
+        [&](While const& loop) {
+          // Counted twice, as a loop body may run many times.
+          count_bindings(loop.body, bindings);
+          count_bindings(loop.body, bindings);
+          count_bindings(loop.or_else, bindings);
+        },
+        [&](For const& loop) {
+          count_target(*loop.target, 2, bindings);
+          count_bindings(loop.body, bindings);
+          count_bindings(loop.body, bindings);
+          count_bindings(loop.or_else, bindings);
+        },
+        [](auto const&) {});
+    mpark::visit(visitor, stmt);
+  }
+}
+
+// Finds the candidate called by call, provided substituting its body into the
+// caller cannot change what any name refers to.
+auto find_candidate(Call const& call, Caller const& caller,
+                    Inliner const& inliner) -> Candidate const* {
+  auto name = mpark::get_if<Name>(call.func.get());
+  if (name == nullptr) return nullptr;
+
+  auto it = inliner.candidates.find(name->id);
+  if (it == inliner.candidates.end()) return nullptr;
+
+  auto const& candidate = it->second;
+  if (candidate.def.args.size() != call.args.size()) return nullptr;
+
+  for (auto scope : caller.scopes) {
+    if (is_local(*scope, name->id)) return nullptr;
+    for (auto&& free : candidate.scope.free) {
+      if (is_local(*scope, free)) return nullptr;
+    }
+  }
+  return &candidate;
+}
+
+void record(Candidate const& candidate, Caller const& caller,
+            Inliner& inliner) {
+  InlinedCall inlined;
+  inlined.callee = candidate.def.name;
+  inlined.caller = caller.name;
+  inlined.size = candidate.size;
+  inliner.report->inlined.push_back(inlined);
+}
+
+// Substitutes the body of a single-return callee for a call with trivial
+// arguments, leaving anything else for the statement-level expansion.
+void substitute_call(Expression& expr, Caller const& caller,
+                     Inliner& inliner) {
+  auto const& call = mpark::get<Call>(expr);
+  auto candidate = find_candidate(call, caller, inliner);
+  if (candidate == nullptr || candidate->def.body.size() != 1) return;
+  for (auto&& arg : call.args) {
+    if (!is_trivial(arg)) return;
+  }
+
+  Renames renames;
+  for (int i = 0; i < call.args.size(); ++i) {
+    renames[candidate->def.args[i]] = call.args[i];
+  }
+  bool ok = true;
+  auto const& ret = mpark::get<Return>(candidate->def.body.front());
+  record(*candidate, caller, inliner);
+  expr = substitute(*ret.value, renames, ok);
+}
+
+// Rewrites the calls in expr, innermost first. Copies each node before
+// rewriting it in place, from an explicit stack like visit_nodes, and visits
+// a call a second time once its function and arguments are done.
+auto inline_expr(Expression const& expr, Caller const& caller,
+                 Inliner& inliner) -> Expression {
+  Expression result = expr;
+  std::vector<std::pair<Expression*, bool>> pending = {{&result, false}};
+  auto push = [&](Expression& child) { pending.push_back({&child, false}); };
+  auto copy = [&](std::shared_ptr<Expression>& child) {
+    child = std::make_shared<Expression>(*child);
+    push(*child);
+  };
+  auto push_all = [&](std::vector<Expression>& exprs) {
+    for (auto it = exprs.rbegin(); it != exprs.rend(); ++it) push(*it);
+  };
+
+  auto children = Util::make_visitor(
+      [&](BoolOp& op) {
+        copy(op.right);
+        copy(op.left);
+      },
+      [&](BinOp& op) {
+        copy(op.right);
+        copy(op.left);
+      },
+      [&](Compare& cmp) {
+        push_all(cmp.comparators);
+        copy(cmp.left);
+      },
+      [&](Call& call) {
+        push_all(call.args);
+        copy(call.func);
+      },
+      [](auto const&) {});
+
+  while (!pending.empty()) {
+    auto node = pending.back();
+    pending.pop_back();
+    if (node.second) {
+      substitute_call(*node.first, caller, inliner);
+      continue;
+    }
+    if (mpark::holds_alternative<Call>(*node.first)) {
+      pending.push_back({node.first, true});
+    }
+    mpark::visit(children, *node.first);
+  }
+  return result;
+}
+
+auto inline_child(std::shared_ptr<Expression> const& child,
+                  Caller const& caller, Inliner& inliner)
+    -> std::shared_ptr<Expression> {
+  return std::make_shared<Expression>(inline_expr(*child, caller, inliner));
+}
+
+// Expands a call in statement position into assignments to fresh locals,
+// returning the expression that replaces it, or nullptr if value is not an
+// inlinable call. Calls at module level are never expanded, as the fresh names
+// would become globals that the program could see and that outlive the call.
+auto expand(Expression const& value, Caller const& caller, Inliner& inliner,
+            std::vector<Statement>& out) -> std::shared_ptr<Expression> {
+  auto call = mpark::get_if<Call>(&value);
+  if (call == nullptr || caller.scopes.empty()) return nullptr;
+
+  auto candidate = find_candidate(*call, caller, inliner);
+  if (candidate == nullptr) return nullptr;
+
+  auto id = std::to_string(++inliner.fresh);
+  Renames renames;
+  for (auto&& local : candidate->scope.locals) {
+    Name fresh;
+    fresh.id = candidate->def.name + "$" + id + "$" + local;
+    fresh.meta = call->meta;
+    renames[local] = fresh;
+  }
+
+  for (int i = 0; i < call->args.size(); ++i) {
+    Assign bind;
+    bind.targets = {renames.at(candidate->def.args[i])};
+    bind.value = std::make_shared<Expression>(call->args[i]);
+    bind.meta = call->meta;
+    out.push_back(bind);
+  }
+
+  bool ok = true;
+  auto const& body = candidate->def.body;
+  for (int i = 0; i + 1 < body.size(); ++i) {
+    auto const& assign = mpark::get<Assign>(body[i]);
+    auto const& target = mpark::get<Name>(assign.targets.front());
+
+    Assign renamed;
+    renamed.targets = {renames.at(target.id)};
+    renamed.value =
+        std::make_shared<Expression>(substitute(*assign.value, renames, ok));
+    renamed.meta = assign.meta;
+    out.push_back(renamed);
+  }
+
+  record(*candidate, caller, inliner);
+  auto const& ret = mpark::get<Return>(body.back());
+  return std::make_shared<Expression>(substitute(*ret.value, renames, ok));
+}
+
+auto inline_stmts(std::vector<Statement> const& body, Caller const& caller,
+                  Inliner& inliner, bool top_level) -> std::vector<Statement>;
+
+void inline_stmt(Statement const& stmt, Caller const& caller, Inliner& inliner,
+                 bool top_level, std::vector<Statement>& out) {
+  auto visitor = Util::make_visitor(
+      [&](FunctionDef def) {
+        auto scope = resolve_scope(def);
+        Caller inner = caller;
+        inner.name = def.name;
+        inner.scopes.push_back(&scope);
+        def.body = inline_stmts(def.body, inner, inliner, false);
+        out.push_back(def);
+
+        if (top_level) {
+          Candidate candidate;
+          auto reason = check_candidate(def, inliner, candidate);
+          if (reason.empty()) {
+            inliner.candidates[def.name] = candidate;
+          } else {
+            inliner.report->rejected[def.name] = reason;
+          }
+        }
+      },
+      [&](Return ret) {
+        if (ret.value) {
+          auto value = inline_expr(*ret.value, caller, inliner);
+          ret.value = expand(value, caller, inliner, out);
+          if (!ret.value) ret.value = std::make_shared<Expression>(value);
+        }
+        out.push_back(ret);
+      },
+      [&](Assign assign) {
+        auto value = inline_expr(*assign.value, caller, inliner);
+        assign.value = expand(value, caller, inliner, out);
+        if (!assign.value) assign.value = std::make_shared<Expression>(value);
+        out.push_back(assign);
+      },
+      [&](AugAssign aug) {
+        aug.value = inline_child(aug.value, caller, inliner);
+        out.push_back(aug);
+      },
+      [&](If if_stmt) {
+        if_stmt.test = inline_child(if_stmt.test, caller, inliner);
+        if_stmt.body = inline_stmts(if_stmt.body, caller, inliner, false);
+        if_stmt.or_else = inline_stmts(if_stmt.or_else, caller, inliner, false);
+        out.push_back(if_stmt);
+      },
+      [&](While loop) {
+        loop.test = inline_child(loop.test, caller, inliner);
+        loop.body = inline_stmts(loop.body, caller, inliner, false);
+        loop.or_else = inline_stmts(loop.or_else, caller, inliner, false);
+        out.push_back(loop);
+      },
+      [&](For loop) {
+        loop.iter = inline_child(loop.iter, caller, inliner);
+        loop.body = inline_stmts(loop.body, caller, inliner, false);
+        loop.or_else = inline_stmts(loop.or_else, caller, inliner, false);
+        out.push_back(loop);
+      },
+      [&](Expr expr) {
+        auto value = inline_expr(*expr.value, caller, inliner);
+        expr.value = expand(value, caller, inliner, out);
+        if (!expr.value) expr.value = std::make_shared<Expression>(value);
+        out.push_back(expr);
+      },
+      [&](Print print) {
+        for (auto&& obj : print.objects) {
+          obj = inline_expr(obj, caller, inliner);
+        }
+        out.push_back(print);
+      });
+  mpark::visit(visitor, stmt);
+}
+
+auto inline_stmts(std::vector<Statement> const& body, Caller const& caller,
+                  Inliner& inliner, bool top_level) -> std::vector<Statement> {
+  std::vector<Statement> out;
+  out.reserve(body.size());
+  for (auto&& stmt : body) {
+    inline_stmt(stmt, caller, inliner, top_level, out);
+  }
+  return out;
+}
+}  // namespace
+
+auto inline_functions(Module const& ast, InlineReport& report,
+                      InlineOptions const& options) -> Module {
+  Inliner inliner;
+  inliner.options = options;
+  inliner.report = &report;
+  count_bindings(ast.body, inliner.module_bindings);
+
+  Module result = ast;
+  result.body = inline_stmts(ast.body, Caller(), inliner, true);
+  return result;
+}
+}  // namespace MyPython
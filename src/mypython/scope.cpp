@@ -0,0 +1,204 @@
+#include <mypython/scope.hpp>
+
+#include <algorithm>
+#include <map>
+
+#include <util/variant.hpp>
+
+namespace MyPython {
+namespace {
+struct ScopeBuilder {
+  Scope scope = {};
+  std::vector<std::string> reads = {};
+
+  // Statements are numbered in the order they are walked. Parameters are
+  // bound at position 0.
+  int position = 0;
+  std::map<std::string, int> bindings = {};
+  std::map<std::string, int> last_binding = {};
+  std::map<std::string, int> first_capture = {};
+  // How many loops enclose the statement being walked.
+  int loop_depth = 0;
+};
+
+void add_unique(std::vector<std::string>& names, std::string const& name) {
+  if (std::find(names.begin(), names.end(), name) == names.end()) {
+    names.push_back(name);
+  }
+}
+
+void bind(std::string const& name, ScopeBuilder& builder) {
+  add_unique(builder.scope.locals, name);
+  // A binding inside a loop may run many times.
+  builder.bindings[name] += builder.loop_depth > 0 ? 2 : 1;
+  builder.last_binding[name] = builder.position;
+}
+
+void walk(Expression const& expr, ScopeBuilder& builder);
+void walk(Statement const& stmt, ScopeBuilder& builder);
+
+// Binds the names an assignment to target binds, and walks the rest.
+void bind_target(Expression const& target, ScopeBuilder& builder) {
+  if (auto name = mpark::get_if<Name>(&target)) {
+    bind(name->id, builder);
+  } else if (auto tuple = mpark::get_if<Tuple>(&target)) {
+    for (auto&& elt : tuple->elts) bind_target(elt, builder);
+  } else {
+    walk(target, builder);
+  }
+}
+
+// Walks expressions from an explicit stack, children in order, so that the
+// depth of an expression tree never reaches the native stack. Only the
+// nesting of comprehensions does.
+void walk(Expression const& root, ScopeBuilder& builder) {
+  std::vector<Expression const*> pending = {&root};
+  auto push = [&](Expression const& expr) { pending.push_back(&expr); };
+  auto push_all = [&](std::vector<Expression> const& exprs) {
+    for (auto it = exprs.rbegin(); it != exprs.rend(); ++it) push(*it);
+  };
+
+  auto visitor = Util::make_visitor(
+      [&](BoolOp const& op) {
+        push(*op.right);
+        push(*op.left);
+      },
+      [&](BinOp const& op) {
+        push(*op.right);
+        push(*op.left);
+      },
+      [&](Call const& call) {
+        push_all(call.args);
+        push(*call.func);
+      },
+      [&](Compare const& cmp) {
+        push_all(cmp.comparators);
+        push(*cmp.left);
+      },
+      [&](Name const& name) { add_unique(builder.reads, name.id); },
+      [&](Attribute const& attr) { push(*attr.value); },
+      [&](List const& list) { push_all(list.elts); },
+      [&](ListComp const& comp) {
+        walk(*comp.iter, builder);
+        ++builder.loop_depth;
+        bind_target(*comp.target, builder);
+        for (auto&& test : comp.ifs) walk(test, builder);
+        walk(*comp.elt, builder);
+        --builder.loop_depth;
+      },
+      [&](Dict const& dict) {
+        for (int i = dict.keys.size() - 1; i >= 0; --i) {
+          push(dict.values[i]);
+          push(dict.keys[i]);
+        }
+      },
+      [&](Tuple const& tuple) { push_all(tuple.elts); },
+      [&](Subscript const& sub) {
+        push(*sub.index);
+        push(*sub.value);
+      },
+      [&](Yield const& yield) {
+        builder.scope.generator = true;
+        if (yield.value) push(*yield.value);
+      },
+      [](auto const&) {});
+
+  while (!pending.empty()) {
+    auto expr = pending.back();
+    pending.pop_back();
+    mpark::visit(visitor, *expr);
+  }
+}
+
+void walk(Statement const& stmt, ScopeBuilder& builder) {
+  ++builder.position;
+  auto visitor = Util::make_visitor(
+      [&](FunctionDef const& def) {
+        for (auto&& name : resolve_scope(def).free) {
+          add_unique(builder.reads, name);
+          builder.first_capture.insert({name, builder.position});
+        }
+        bind(def.name, builder);
+      },
+      [&](Return const& ret) {
+        if (ret.value) walk(*ret.value, builder);
+      },
+      [&](Assign const& assign) {
+        walk(*assign.value, builder);
+        for (auto&& target : assign.targets) bind_target(target, builder);
+      },
+      [&](AugAssign const& aug) {
+        walk(*aug.value, builder);
+        walk(*aug.target, builder);
+        bind_target(*aug.target, builder);
+      },
+      [&](If const& if_stmt) {
+        walk(*if_stmt.test, builder);
+        for (auto&& body_stmt : if_stmt.body) walk(body_stmt, builder);
+        for (auto&& body_stmt : if_stmt.or_else) walk(body_stmt, builder);
+      },
+      [&](While const& loop) {
+        ++builder.loop_depth;
+        walk(*loop.test, builder);
+        for (auto&& body_stmt : loop.body) walk(body_stmt, builder);
+        --builder.loop_depth;
+        for (auto&& body_stmt : loop.or_else) walk(body_stmt, builder);
+      },
+      [&](For const& loop) {
+        walk(*loop.iter, builder);
+        ++builder.loop_depth;
+        bind_target(*loop.target, builder);
+        for (auto&& body_stmt : loop.body) walk(body_stmt, builder);
+        --builder.loop_depth;
+        for (auto&& body_stmt : loop.or_else) walk(body_stmt, builder);
+      },
+      [&](Expr const& expr) { walk(*expr.value, builder); },
+      [&](Print const& print) {
+        for (auto&& obj : print.objects) walk(obj, builder);
+      });
+  mpark::visit(visitor, stmt);
+}
+}  // namespace
+
+auto resolve_scope(FunctionDef const& def) -> Scope {
+  ScopeBuilder builder;
+  for (auto&& arg : def.args) bind(arg, builder);
+  for (auto&& stmt : def.body) walk(stmt, builder);
+
+  for (auto&& name : builder.reads) {
+    if (!is_local(builder.scope, name)) builder.scope.free.push_back(name);
+  }
+
+  // A captured local needs a cell if it is rebound, or if it is first bound
+  // no earlier than the definition that captures it.
+  for (auto&& name : builder.scope.locals) {
+    auto capture = builder.first_capture.find(name);
+    if (capture == builder.first_capture.end()) continue;
+    if (builder.bindings[name] > 1 ||
+        builder.last_binding[name] >= capture->second) {
+      builder.scope.cells.push_back(name);
+    }
+  }
+  return builder.scope;
+}
+
+auto is_local(Scope const& scope, std::string const& name) -> bool {
+  return slot_of(scope, name) >= 0;
+}
+
+auto is_free(Scope const& scope, std::string const& name) -> bool {
+  return std::find(scope.free.begin(), scope.free.end(), name) !=
+         scope.free.end();
+}
+
+auto is_cell(Scope const& scope, std::string const& name) -> bool {
+  return std::find(scope.cells.begin(), scope.cells.end(), name) !=
+         scope.cells.end();
+}
+
+auto slot_of(Scope const& scope, std::string const& name) -> int {
+  auto it = std::find(scope.locals.begin(), scope.locals.end(), name);
+  if (it == scope.locals.end()) return -1;
+  return it - scope.locals.begin();
+}
+}  // namespace MyPython
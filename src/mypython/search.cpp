@@ -0,0 +1,120 @@
+#include <mypython/search.hpp>
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace MyPython {
+namespace {
+using FindFn = std::size_t (*)(char const*, std::size_t, char const*,
+                               std::size_t);
+
+// Trivial needles, which every version handles the same way. Returns true
+// and sets result if the search is already decided.
+auto trivial(char const* haystack, std::size_t n, char const* needle,
+             std::size_t k, std::size_t& result) -> bool {
+  if (k == 0) {
+    result = 0;
+  } else if (k > n) {
+    result = not_found;
+  } else if (k == 1) {
+    auto match = std::memchr(haystack, needle[0], n);
+    result = match ? static_cast<char const*>(match) - haystack : not_found;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+auto choose() -> FindFn {
+#if defined(__x86_64__) || defined(__i386__)
+  return has_avx2() ? find_avx2 : find_sse2;
+#else
+  return find_scalar;
+#endif
+}
+
+FindFn const best = choose();
+}  // namespace
+
+auto find_scalar(char const* haystack, std::size_t n, char const* needle,
+                 std::size_t k) -> std::size_t {
+  std::size_t result = 0;
+  if (trivial(haystack, n, needle, k, result)) return result;
+
+  // Jump between occurrences of the first byte.
+  auto const last = haystack + (n - k);
+  for (auto p = haystack; p <= last; ++p) {
+    p = static_cast<char const*>(std::memchr(p, needle[0], last - p + 1));
+    if (p == nullptr) break;
+    if (std::memcmp(p + 1, needle + 1, k - 1) == 0) return p - haystack;
+  }
+  return not_found;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+auto find_sse2(char const* haystack, std::size_t n, char const* needle,
+               std::size_t k) -> std::size_t {
+  std::size_t result = 0;
+  if (trivial(haystack, n, needle, k, result)) return result;
+
+  auto const first = _mm_set1_epi8(needle[0]);
+  auto const last = _mm_set1_epi8(needle[k - 1]);
+  std::size_t i = 0;
+  // Bit j of mask is set when both ends of the needle match at i + j.
+  for (; i + k - 1 + 16 <= n; i += 16) {
+    auto block_first = _mm_loadu_si128(
+        reinterpret_cast<__m128i const*>(haystack + i));
+    auto block_last = _mm_loadu_si128(
+        reinterpret_cast<__m128i const*>(haystack + i + k - 1));
+    auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(
+        _mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last))));
+    for (; mask != 0; mask &= mask - 1) {
+      auto j = i + __builtin_ctz(mask);
+      if (std::memcmp(haystack + j + 1, needle + 1, k - 2) == 0) return j;
+    }
+  }
+  auto rest = find_scalar(haystack + i, n - i, needle, k);
+  return rest == not_found ? not_found : i + rest;
+}
+
+__attribute__((target("avx2"))) auto find_avx2(char const* haystack,
+                                               std::size_t n,
+                                               char const* needle,
+                                               std::size_t k) -> std::size_t {
+  std::size_t result = 0;
+  if (trivial(haystack, n, needle, k, result)) return result;
+
+  auto const first = _mm256_set1_epi8(needle[0]);
+  auto const last = _mm256_set1_epi8(needle[k - 1]);
+  std::size_t i = 0;
+  for (; i + k - 1 + 32 <= n; i += 32) {
+    auto block_first = _mm256_loadu_si256(
+        reinterpret_cast<__m256i const*>(haystack + i));
+    auto block_last = _mm256_loadu_si256(
+        reinterpret_cast<__m256i const*>(haystack + i + k - 1));
+    auto mask = static_cast<unsigned>(_mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(first, block_first),
+                         _mm256_cmpeq_epi8(last, block_last))));
+    for (; mask != 0; mask &= mask - 1) {
+      auto j = i + __builtin_ctz(mask);
+      if (std::memcmp(haystack + j + 1, needle + 1, k - 2) == 0) return j;
+    }
+  }
+  auto rest = find_scalar(haystack + i, n - i, needle, k);
+  return rest == not_found ? not_found : i + rest;
+}
+
+auto has_avx2() -> bool {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+#endif
+
+auto find(char const* haystack, std::size_t n, char const* needle,
+          std::size_t k) -> std::size_t {
+  return best(haystack, n, needle, k);
+}
+}  // namespace MyPython
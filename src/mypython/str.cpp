@@ -0,0 +1,219 @@
+#include <mypython/ast.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <new>
+#include <unordered_set>
+#include <utility>
+
+namespace MyPython {
+static_assert(sizeof(PyStr) == 32, "PyStr should stay as small as std::string");
+
+namespace {
+auto is_ascii(char const* data, std::size_t size) -> bool {
+  // Test eight bytes at a time for a set high bit.
+  std::uint64_t high = 0;
+  std::size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    std::uint64_t word = 0;
+    std::memcpy(&word, data + i, 8);
+    high |= word;
+  }
+  for (; i < size; ++i) high |= static_cast<unsigned char>(data[i]);
+  return (high & 0x8080808080808080ULL) == 0;
+}
+
+// Whether c is a byte after the first of a code point.
+auto continues(char c) -> bool {
+  return (static_cast<unsigned char>(c) & 0xc0) == 0x80;
+}
+
+auto count_code_points(char const* data, std::size_t size) -> std::size_t {
+  return std::count_if(data, data + size, [](char c) { return !continues(c); });
+}
+
+struct StrHash {
+  auto operator()(PyStr const& s) const -> std::size_t { return s.hash(); }
+};
+
+struct StrEqual {
+  auto operator()(PyStr const& a, PyStr const& b) const -> bool {
+    return equal(a, b);
+  }
+};
+
+auto intern_table() -> std::unordered_set<PyStr, StrHash, StrEqual>& {
+  static std::unordered_set<PyStr, StrHash, StrEqual> table;
+  return table;
+}
+
+auto is_identifier_like(std::string const& s) -> bool {
+  return std::all_of(s.begin(), s.end(), [](char c) {
+    return c == '_' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+           (c >= 'A' && c <= 'Z');
+  });
+}
+}  // namespace
+
+auto PyStr::intern(std::string const& value) -> PyStr {
+  auto& table = intern_table();
+  PyStr key(value);
+  auto it = table.find(key);
+  if (it != table.end()) return *it;
+
+  // Move even short strings into a buffer, so that identity is comparable.
+  PyStr interned;
+  auto out = interned.allocate(
+      value.size(), std::max(value.size(), inline_capacity + 1));
+  std::memcpy(out, value.data(), value.size());
+  interned.meta_ = key.meta_ & ascii_flag;
+  interned.meta_ |= heap_flag | interned_flag;
+  return *table.insert(interned).first;
+}
+
+PyStr::PyStr(char const* data, std::size_t size) {
+  std::memcpy(allocate(size, size), data, size);
+  if (!is_ascii(data, size)) meta_ &= ~ascii_flag;
+}
+
+PyStr::PyStr(PyStr const& other) : hash_(other.hash_), meta_(other.meta_) {
+  std::memcpy(small_, other.small_, inline_capacity);
+  if (heap()) ++buffer()->refs;
+}
+
+PyStr::PyStr(PyStr&& other) noexcept
+    : hash_(other.hash_), meta_(other.meta_) {
+  std::memcpy(small_, other.small_, inline_capacity);
+  other.hash_ = 0;
+  other.meta_ = ascii_flag;
+}
+
+auto PyStr::operator=(PyStr const& other) -> PyStr& {
+  if (this != &other) *this = PyStr(other);
+  return *this;
+}
+
+auto PyStr::operator=(PyStr&& other) noexcept -> PyStr& {
+  if (this != &other) {
+    release();
+    hash_ = other.hash_;
+    meta_ = other.meta_;
+    std::memcpy(small_, other.small_, inline_capacity);
+    other.hash_ = 0;
+    other.meta_ = ascii_flag;
+  }
+  return *this;
+}
+
+PyStr::~PyStr() { release(); }
+
+auto literal_str(std::string const& s) -> PyStr {
+  return is_identifier_like(s) ? PyStr::intern(s) : PyStr(s);
+}
+
+auto equal(PyStr const& a, PyStr const& b) -> bool {
+  if (a.same_buffer(b)) return true;
+  if (a.interned() && b.interned()) return false;
+  return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size()) == 0;
+}
+
+auto PyStr::hash() const -> std::size_t {
+  // FNV-1a.
+  if (hash_ == 0) {
+    std::uint64_t h = 14695981039346656037ULL;
+    for (auto p = data(), end = p + size(); p != end; ++p) {
+      h = (h ^ static_cast<unsigned char>(*p)) * 1099511628211ULL;
+    }
+    hash_ = h;
+  }
+  return hash_;
+}
+
+auto PyStr::length() const -> std::size_t {
+  if (ascii()) return size();
+  if (!heap()) return count_code_points(data(), size());
+  if (buffer()->length == unknown_length) {
+    buffer()->length = count_code_points(data(), size());
+  }
+  return buffer()->length;
+}
+
+auto PyStr::next(std::size_t pos) const -> std::size_t {
+  if (ascii()) return pos + 1;
+  auto const end = size();
+  do {
+    ++pos;
+  } while (pos < end && continues(data()[pos]));
+  return pos;
+}
+
+auto PyStr::offset(std::size_t index) const -> std::size_t {
+  if (ascii()) return index;
+  std::size_t pos = 0;
+  for (; index > 0; --index) pos = next(pos);
+  return pos;
+}
+
+auto PyStr::repeat(std::size_t count) const -> PyStr {
+  auto const n = size();
+  if (n == 0 || count == 0) return PyStr();
+  if (count > std::numeric_limits<std::size_t>::max() / 2 / n) {
+    throw "Repeated string is too long";
+  }
+
+  // Copy once, then double the filled prefix until it covers the result.
+  PyStr result;
+  auto total = n * count;
+  auto out = result.allocate(total, total);
+  std::memcpy(out, data(), n);
+  for (auto filled = n; filled < total; filled *= 2) {
+    std::memcpy(out + filled, out, std::min(filled, total - filled));
+  }
+  result.meta_ = (result.meta_ & ~ascii_flag) | (meta_ & ascii_flag);
+  return result;
+}
+
+void PyStr::append(PyStr const& other) {
+  auto const old = size();
+  auto const n = other.size();
+  auto const total = old + n;
+  auto const ascii_bit = meta_ & other.meta_ & ascii_flag;
+  auto const unique = heap() && buffer()->refs == 1;
+
+  // other may be this string, so its bytes are read before anything moves.
+  if (unique && buffer()->capacity >= total) {
+    std::memmove(reinterpret_cast<char*>(buffer() + 1) + old, other.data(), n);
+    buffer()->size = total;
+    buffer()->length = unknown_length;
+  } else if (!heap() && total <= inline_capacity) {
+    std::memmove(small_ + old, other.data(), n);
+    meta_ = (meta_ & ~size_mask) | total;
+  } else {
+    // Leave room to grow a string that is being built up, but size a copy of
+    // a shared one exactly.
+    PyStr grown;
+    auto out = grown.allocate(total, unique ? std::max(total, 2 * old) : total);
+    std::memcpy(out, data(), old);
+    std::memcpy(out + old, other.data(), n);
+    *this = std::move(grown);
+  }
+  meta_ = (meta_ & ~ascii_flag) | ascii_bit;
+  hash_ = 0;
+}
+
+auto PyStr::allocate(std::size_t size, std::size_t capacity) -> char* {
+  if (capacity <= inline_capacity) {
+    meta_ = ascii_flag | static_cast<std::uint8_t>(size);
+    return small_;
+  }
+  void* memory = ::operator new(sizeof(Buffer) + capacity);
+  auto buffer = new (memory) Buffer{1, size, capacity, unknown_length};
+  std::memcpy(small_, &buffer, sizeof(buffer));
+  meta_ = ascii_flag | heap_flag;
+  return reinterpret_cast<char*>(buffer + 1);
+}
+
+void PyStr::release() {
+  if (heap() && --buffer()->refs == 0) ::operator delete(buffer());
+}
+}  // namespace MyPython
@@ -0,0 +1,98 @@
+#include <mypython/ast.hpp>
+
+#include <algorithm>
+#include <new>
+
+namespace MyPython {
+namespace {
+// Caps each free list, so that a burst of tuples is not held forever.
+constexpr int max_free = 2000;
+}  // namespace
+
+// Free blocks of each pooled size, linked through their headers.
+struct PyTuple::Pool {
+  Block* heads[max_pooled + 1] = {};
+  int counts[max_pooled + 1] = {};
+};
+
+auto PyTuple::pool() -> Pool& {
+  static Pool pool;
+  return pool;
+}
+
+auto PyTuple::allocate(std::size_t size) -> Block* {
+  Block* block = nullptr;
+  auto& lists = pool();
+  if (size <= max_pooled && lists.heads[size] != nullptr) {
+    block = lists.heads[size];
+    lists.heads[size] = block->next;
+    --lists.counts[size];
+  } else {
+    block = static_cast<Block*>(::operator new(
+        sizeof(Block) + size * sizeof(std::shared_ptr<PyObj>)));
+  }
+  block->refs = 1;
+  block->size = size;
+  auto items = reinterpret_cast<std::shared_ptr<PyObj>*>(block + 1);
+  for (std::size_t i = 0; i < size; ++i) {
+    new (items + i) std::shared_ptr<PyObj>();
+  }
+  return block;
+}
+
+PyTuple::PyTuple(std::shared_ptr<PyObj>* values, std::size_t size) {
+  if (size == 0) return;
+  block_ = allocate(size);
+  auto out = items();
+  for (std::size_t i = 0; i < size; ++i) out[i] = std::move(values[i]);
+}
+
+PyTuple::PyTuple(std::initializer_list<std::shared_ptr<PyObj>> values) {
+  if (values.size() == 0) return;
+  block_ = allocate(values.size());
+  std::copy(values.begin(), values.end(), items());
+}
+
+PyTuple::PyTuple(PyTuple const& other) : block_(other.block_) {
+  if (block_) ++block_->refs;
+}
+
+PyTuple::PyTuple(PyTuple&& other) noexcept : block_(other.block_) {
+  other.block_ = nullptr;
+}
+
+auto PyTuple::operator=(PyTuple const& other) -> PyTuple& {
+  if (this != &other) *this = PyTuple(other);
+  return *this;
+}
+
+auto PyTuple::operator=(PyTuple&& other) noexcept -> PyTuple& {
+  if (this != &other) {
+    release();
+    block_ = other.block_;
+    other.block_ = nullptr;
+  }
+  return *this;
+}
+
+PyTuple::~PyTuple() { release(); }
+
+void PyTuple::release() {
+  if (!block_ || --block_->refs != 0) return;
+  auto block = block_;
+  block_ = nullptr;
+
+  auto size = block->size;
+  auto values = reinterpret_cast<std::shared_ptr<PyObj>*>(block + 1);
+  for (std::size_t i = 0; i < size; ++i) values[i].~shared_ptr();
+
+  auto& lists = pool();
+  if (size <= max_pooled && lists.counts[size] < max_free) {
+    block->next = lists.heads[size];
+    lists.heads[size] = block;
+    ++lists.counts[size];
+  } else {
+    ::operator delete(block);
+  }
+}
+}  // namespace MyPython
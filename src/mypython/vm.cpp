@@ -0,0 +1,673 @@
+#include <mypython/vm.hpp>
+
+#include <mypython/scope.hpp>
+
+namespace MyPython {
+namespace {
+auto pop(Frame& frame) -> std::shared_ptr<PyObj> {
+  auto value = std::move(frame.values.back());
+  frame.values.pop_back();
+  return value;
+}
+
+auto cell_at(Frame const& frame, int slot) -> Cell* {
+  if (frame.cells.empty()) return nullptr;
+  return frame.cells[slot].get();
+}
+
+auto load_free(Frame const& frame, int index, Stack const& stack)
+    -> std::shared_ptr<PyObj> {
+  auto slot = frame.code->nlocals + index;
+  if (auto cell = cell_at(frame, slot)) {
+    if (!cell->value) throw "Free variable referenced before assignment";
+    return cell->value;
+  }
+  if (frame.slots[slot]) return frame.slots[slot];
+  return lookup_global(frame.code->scope->free[index], stack);
+}
+
+auto make_function(Frame const& frame, int index) -> PyFunction {
+  PyFunction fun;
+  fun.def = frame.code->defs[index];
+  fun.code = frame.code->functions[index];
+  fun.scope = fun.code->scope;
+
+  auto const& sources = frame.code->captures[index];
+  if (sources.empty()) return fun;
+
+  fun.captures.resize(sources.size());
+  fun.cells.resize(sources.size());
+  for (int i = 0; i < sources.size(); ++i) {
+    if (sources[i] < 0) continue;
+    if (!frame.cells.empty() && frame.cells[sources[i]]) {
+      fun.cells[i] = frame.cells[sources[i]];
+    } else {
+      fun.captures[i] = frame.slots[sources[i]];
+    }
+  }
+  return fun;
+}
+
+void check_depth(std::vector<Frame> const& frames, VMOptions const& options) {
+  if (frames.size() > options.recursion_limit) {
+    throw "Maximum recursion depth exceeded";
+  }
+}
+
+// Moves a suspended generator frame onto the frame stack.
+void push_resumed(std::vector<Frame>& frames,
+                  std::shared_ptr<Generator> const& gen,
+                  VMOptions const& options) {
+  if (gen->running) throw "Generator already executing";
+  if (gen->finished) throw "StopIteration";
+  check_depth(frames, options);
+
+  frames.push_back(std::move(gen->frame));
+  auto& frame = frames.back();
+  frame.generator = gen;
+  // The suspended yield expression evaluates to None.
+  if (gen->started) frame.values.push_back(std::make_shared<PyObj>());
+  gen->started = true;
+  gen->running = true;
+}
+
+// Replaces the callee and arguments on top of the caller's operand stack with
+// a new frame. Arguments move straight from the operand stack into the
+// callee's parameter slots.
+void enter(std::vector<Frame>& frames, CallSite& site, Stack& stack,
+           VMOptions const& options) {
+  auto& caller = frames.back();
+  auto base = caller.values.size() - site.argc - 1;
+  auto callee = caller.values[base];
+
+  if (auto builtin = mpark::get_if<PyBuiltin>(callee.get())) {
+    // next() on a generator resumes it here, without a nested VM loop.
+    auto gen = site.argc == 1 && builtin->name == "next"
+                   ? mpark::get_if<PyGenerator>(caller.values.back().get())
+                   : nullptr;
+    if (gen != nullptr) {
+      auto state = gen->state;
+      caller.values.resize(base);
+      push_resumed(frames, state, options);
+      return;
+    }
+
+    std::vector<std::shared_ptr<PyObj>> args(
+        std::make_move_iterator(caller.values.begin() + base + 1),
+        std::make_move_iterator(caller.values.end()));
+    caller.values.resize(base);
+    caller.values.push_back(builtin->fun(args, stack));
+    return;
+  }
+
+  auto fun = mpark::get_if<PyFunction>(callee.get());
+  if (fun == nullptr) throw "Object is not callable";
+  if (!fun->code) fun->code = compile(fun->def);
+
+  auto const& code = fun->code;
+  if (site.checked.owner_before(code) || code.owner_before(site.checked)) {
+    if (fun->def.args.size() != site.argc) throw "Wrong number of arguments";
+    site.checked = code;
+  }
+
+  auto frame = make_frame(*fun, &caller.values[base + 1], site.argc);
+  caller.values.resize(base);
+  if (code->scope->generator) {
+    auto gen = std::make_shared<Generator>();
+    gen->frame = std::move(frame);
+    PyGenerator obj;
+    obj.state = gen;
+    caller.values.push_back(std::make_shared<PyObj>(obj));
+  } else {
+    check_depth(frames, options);
+    frames.push_back(std::move(frame));
+  }
+}
+
+// In `s = s + t` the binding of s is replaced as soon as the sum is stored.
+// Dropping it first leaves the operand as the only reference to s, so the sum
+// can append to it in place. Only called when the sum cannot throw.
+void release_target(Frame& frame, Stack& stack,
+                    std::shared_ptr<PyObj> const& a) {
+  if (frame.pc == frame.code->instrs.size()) return;
+  auto const& next = frame.code->instrs[frame.pc];
+  if (next.op == OpCode::store_fast) {
+    auto& slot = frame.slots[next.arg];
+    if (slot == a) slot.reset();
+  } else if (next.op == OpCode::store_global) {
+    auto it = stack.globals.find(frame.code->names[next.arg]);
+    if (it != stack.globals.end() && it->second == a) it->second.reset();
+  }
+}
+
+// Where a value of a type that no literal in table has goes.
+auto mismatch_target(JumpTable const& table, PyObj const& value) -> int {
+  compare_op(CmpOp::eq, value, *table.first);
+  return table.default_target;
+}
+
+auto jump_target(JumpTable const& table, PyObj const& value) -> int {
+  if (!table.dense.empty()) {
+    // Bools and integral floats equal the ints they convert to.
+    long n = 0;
+    if (auto i = mpark::get_if<PyInt>(&value)) {
+      if (i->big) return table.default_target;
+      n = i->value;
+    } else if (auto b = mpark::get_if<PyBool>(&value)) {
+      n = b->value;
+    } else if (auto f = mpark::get_if<PyFloat>(&value)) {
+      auto size = static_cast<long>(table.dense.size());
+      if (!(f->value >= table.low && f->value < table.low + size)) {
+        return table.default_target;
+      }
+      n = static_cast<long>(f->value);
+      if (n != f->value) return table.default_target;
+    } else {
+      return mismatch_target(table, value);
+    }
+    auto offset = static_cast<unsigned long>(n) -
+                  static_cast<unsigned long>(table.low);
+    if (offset >= table.dense.size() || table.dense[offset] < 0) {
+      return table.default_target;
+    }
+    return table.dense[offset];
+  }
+
+  // Numbers that equal an int hash as it does.
+  bool numbers = !mpark::holds_alternative<PyStr>(*table.first);
+  bool number = mpark::holds_alternative<PyInt>(value) ||
+                mpark::holds_alternative<PyBool>(value) ||
+                mpark::holds_alternative<PyFloat>(value);
+  if (numbers ? !number : !mpark::holds_alternative<PyStr>(value)) {
+    return mismatch_target(table, value);
+  }
+  auto slot = (hash(value) >> table.shift) & (table.keys.size() - 1);
+  auto const& key = table.keys[slot];
+  if (key && equal(*key, value)) return table.targets[slot];
+  return table.default_target;
+}
+
+auto make_iterator(std::shared_ptr<PyObj> iterable) -> Iterator {
+  Iterator it;
+  if (auto range = mpark::get_if<PyRange>(iterable.get())) {
+    it.next = range->start;
+    it.step = range->step;
+    it.remaining = length(*range);
+  } else if (auto str = mpark::get_if<PyStr>(iterable.get())) {
+    it.remaining = str->length();
+  } else if (auto list = mpark::get_if<PyList>(iterable.get())) {
+    // Only a hint, as the body may append.
+    it.remaining = list->values.size();
+  } else if (auto dict = mpark::get_if<PyDict>(iterable.get())) {
+    it.remaining = dict->size();
+  } else if (auto tuple = mpark::get_if<PyTuple>(iterable.get())) {
+    it.remaining = tuple->size();
+  } else if (!mpark::holds_alternative<PyGenerator>(*iterable)) {
+    throw "Object is not iterable";
+  }
+  it.iterable = std::move(iterable);
+  return it;
+}
+
+// Produces the next value of the innermost loop of frame, or returns false
+// once it is done. A generator is resumed on top of frame instead, and its
+// value arrives when it yields.
+auto next_value(std::vector<Frame>& frames, VMOptions const& options) -> bool {
+  auto& frame = frames.back();
+  auto& it = frame.iterators.back();
+  if (auto gen = mpark::get_if<PyGenerator>(it.iterable.get())) {
+    if (gen->state->finished) return false;
+    // Invalidates frame.
+    push_resumed(frames, gen->state, options);
+    return true;
+  }
+  if (auto list = mpark::get_if<PyList>(it.iterable.get())) {
+    if (it.next == list->values.size()) return false;
+    frame.values.push_back(list->values[it.next++]);
+    return true;
+  }
+  if (auto dict = mpark::get_if<PyDict>(it.iterable.get())) {
+    if (it.next == dict->size()) return false;
+    frame.values.push_back(dict->entries()[it.next++].key);
+    return true;
+  }
+  if (auto tuple = mpark::get_if<PyTuple>(it.iterable.get())) {
+    if (it.next == tuple->size()) return false;
+    frame.values.push_back((*tuple)[it.next++]);
+    return true;
+  }
+  if (it.remaining == 0) return false;
+  --it.remaining;
+
+  if (auto str = mpark::get_if<PyStr>(it.iterable.get())) {
+    // next is the byte offset of the code point to produce.
+    auto begin = it.next;
+    it.next = str->next(begin);
+    frame.values.push_back(
+        std::make_shared<PyObj>(PyStr(str->data() + begin, it.next - begin)));
+    return true;
+  }
+
+  auto value = it.next;
+  // Stepping past the last value could overflow.
+  if (it.remaining > 0) it.next += it.step;
+
+  // A counter stored straight into a local that nothing else references is
+  // updated in place rather than reallocated.
+  auto const& instrs = frame.code->instrs;
+  if (frame.pc < instrs.size() && instrs[frame.pc].op == OpCode::store_fast) {
+    auto& slot = frame.slots[instrs[frame.pc].arg];
+    auto counter = slot.use_count() == 1 ? mpark::get_if<PyInt>(slot.get())
+                                         : nullptr;
+    if (counter != nullptr && !counter->big) {
+      counter->value = value;
+      ++frame.pc;
+      return true;
+    }
+  }
+  frame.values.push_back(std::make_shared<PyObj>(PyInt(value)));
+  return true;
+}
+
+// Calls a method on the object below the arguments of site. Appending one
+// value to a list is done directly.
+void call_method(Frame& frame, CallSite const& site) {
+  auto base = frame.values.size() - site.argc - 1;
+  auto const& self = frame.values[base];
+  auto list = mpark::get_if<PyList>(self.get());
+  auto const& name = frame.code->names[site.method];
+  if (list != nullptr && site.argc == 1 && name == "append") {
+    list->values.push_back(pop(frame));
+    frame.values.back() = std::make_shared<PyObj>();
+    return;
+  }
+
+  std::vector<std::shared_ptr<PyObj>> args(
+      std::make_move_iterator(frame.values.begin() + base + 1),
+      std::make_move_iterator(frame.values.end()));
+  auto result = MyPython::call_method(self, name, args);
+  frame.values.resize(base);
+  frame.values.push_back(std::move(result));
+}
+
+// Runs until the bottom frame finishes or yields, returning what it yields or
+// returns.
+auto run_frames(std::vector<Frame>& frames, Stack& stack,
+                VMOptions const& options) -> std::shared_ptr<PyObj> {
+  while (true) {
+    auto& frame = frames.back();
+    // Only module code runs off its end; functions end with a return.
+    if (frame.pc == frame.code->instrs.size()) return nullptr;
+
+    auto instr = frame.code->instrs[frame.pc++];
+    switch (instr.op) {
+      case OpCode::load_const:
+        frame.values.push_back(frame.code->consts[instr.arg]);
+        break;
+      case OpCode::load_fast:
+        if (!frame.slots[instr.arg]) {
+          throw "Local variable referenced before assignment";
+        }
+        frame.values.push_back(frame.slots[instr.arg]);
+        break;
+      case OpCode::store_fast:
+        frame.slots[instr.arg] = pop(frame);
+        break;
+      case OpCode::swap_fast: {
+        auto& a = frame.slots[instr.arg & 0xffff];
+        auto& b = frame.slots[static_cast<unsigned>(instr.arg) >> 16];
+        if (!a || !b) throw "Local variable referenced before assignment";
+        a.swap(b);
+        break;
+      }
+      case OpCode::load_deref: {
+        auto const& value = frame.cells[instr.arg]->value;
+        if (!value) throw "Free variable referenced before assignment";
+        frame.values.push_back(value);
+        break;
+      }
+      case OpCode::store_deref:
+        frame.cells[instr.arg]->value = pop(frame);
+        break;
+      case OpCode::load_free:
+        frame.values.push_back(load_free(frame, instr.arg, stack));
+        break;
+      case OpCode::load_global:
+        frame.values.push_back(
+            lookup_global(frame.code->names[instr.arg], stack));
+        break;
+      case OpCode::store_global:
+        stack.globals[frame.code->names[instr.arg]] = pop(frame);
+        break;
+      case OpCode::pop_top:
+        frame.values.pop_back();
+        break;
+      case OpCode::dup_top:
+        frame.values.push_back(frame.values.back());
+        break;
+      case OpCode::binary_op: {
+        auto b = pop(frame);
+        auto a = pop(frame);
+        auto op = static_cast<Op>(instr.arg);
+        if (op == Op::add && mpark::holds_alternative<PyStr>(*a) &&
+            mpark::holds_alternative<PyStr>(*b)) {
+          release_target(frame, stack, a);
+        }
+        frame.values.push_back(binary_op(op, std::move(a), *b));
+        break;
+      }
+      case OpCode::compare_op: {
+        auto b = pop(frame);
+        auto a = pop(frame);
+        frame.values.push_back(
+            py_bool(compare_op(static_cast<CmpOp>(instr.arg), *a, *b)));
+        break;
+      }
+      case OpCode::compare_link: {
+        auto b = pop(frame);
+        auto a = pop(frame);
+        if (compare_op(static_cast<CmpOp>(instr.arg), *a, *b)) {
+          frame.values.push_back(std::move(b));
+          ++frame.pc;
+        } else {
+          frame.values.push_back(py_bool(false));
+        }
+        break;
+      }
+      case OpCode::jump:
+        frame.pc = instr.arg;
+        break;
+      case OpCode::jump_if_false:
+        if (!truth_value(*pop(frame))) frame.pc = instr.arg;
+        break;
+      case OpCode::jump_if_false_or_pop:
+        if (truth_value(*frame.values.back())) {
+          frame.values.pop_back();
+        } else {
+          frame.pc = instr.arg;
+        }
+        break;
+      case OpCode::jump_if_true_or_pop:
+        if (truth_value(*frame.values.back())) {
+          frame.pc = instr.arg;
+        } else {
+          frame.values.pop_back();
+        }
+        break;
+      case OpCode::jump_table:
+        frame.pc = jump_target(frame.code->jump_tables[instr.arg], *pop(frame));
+        break;
+      case OpCode::make_function:
+        frame.values.push_back(
+            std::make_shared<PyObj>(make_function(frame, instr.arg)));
+        break;
+      case OpCode::call:
+        // Invalidates frame.
+        enter(frames, frame.code->call_sites[instr.arg], stack, options);
+        break;
+      case OpCode::call_method:
+        call_method(frame, frame.code->call_sites[instr.arg]);
+        break;
+      case OpCode::return_value: {
+        auto result = pop(frame);
+        if (!frame.code->scope) {
+          EarlyReturn er;
+          er.result = result;
+          throw er;
+        }
+        if (frame.generator) {
+          frame.generator->running = false;
+          frame.generator->finished = true;
+          // Invalidates frame.
+          frames.pop_back();
+          if (frames.empty()) return nullptr;
+          // A for loop over the generator ends; next() raises.
+          auto& caller = frames.back();
+          auto const& resumed_by = caller.code->instrs[caller.pc - 1];
+          if (resumed_by.op != OpCode::for_iter) throw "StopIteration";
+          caller.iterators.pop_back();
+          caller.pc = resumed_by.arg;
+          break;
+        }
+        // Invalidates frame.
+        frames.pop_back();
+        if (frames.empty()) return result;
+        frames.back().values.push_back(std::move(result));
+        break;
+      }
+      case OpCode::yield_value: {
+        auto result = pop(frame);
+        auto gen = std::move(frame.generator);
+        gen->running = false;
+        gen->frame = std::move(frame);
+        // Invalidates frame.
+        frames.pop_back();
+        if (frames.empty()) return result;
+        frames.back().values.push_back(std::move(result));
+        break;
+      }
+      case OpCode::get_iter:
+        frame.iterators.push_back(make_iterator(pop(frame)));
+        if (instr.arg == 1) {
+          mpark::get<PyList>(*frame.values.back())
+              .values.reserve(frame.iterators.back().remaining);
+        }
+        break;
+      case OpCode::for_iter:
+        // Invalidates frame.
+        if (!next_value(frames, options)) {
+          frame.iterators.pop_back();
+          frame.pc = instr.arg;
+        }
+        break;
+      case OpCode::get_counter:
+        frame.iterators.push_back(make_iterator(pop(frame)));
+        if (mpark::holds_alternative<PyRange>(
+                *frame.iterators.back().iterable)) {
+          frame.iterators.back().slot = instr.arg;
+        }
+        break;
+      case OpCode::next_count: {
+        // Otherwise the loop's for_iter, which follows, ends it.
+        auto& it = frame.iterators.back();
+        if (it.slot < 0 || it.remaining == 0) break;
+        --it.remaining;
+        auto value = it.next;
+        // Stepping past the last value could overflow.
+        if (it.remaining > 0) it.next += it.step;
+
+        // The counter is updated in place unless the body kept a reference
+        // to it or rebound the slot to something else.
+        auto& slot = frame.slots[it.slot];
+        auto counter = slot.use_count() == 1 ? mpark::get_if<PyInt>(slot.get())
+                                             : nullptr;
+        if (counter != nullptr && !counter->big) {
+          counter->value = value;
+        } else {
+          slot = std::make_shared<PyObj>(PyInt(value));
+        }
+        frame.pc = instr.arg;
+        break;
+      }
+      case OpCode::jump_if_not_range: {
+        static auto const& range = builtins().at("range");
+        if (pop(frame) != range) frame.pc = instr.arg;
+        break;
+      }
+      case OpCode::build_list: {
+        PyList list;
+        auto first = frame.values.end() - instr.arg;
+        list.values.assign(std::make_move_iterator(first),
+                           std::make_move_iterator(frame.values.end()));
+        frame.values.resize(frame.values.size() - instr.arg);
+        frame.values.push_back(std::make_shared<PyObj>(std::move(list)));
+        break;
+      }
+      case OpCode::build_map: {
+        auto result = std::make_shared<PyObj>(PyDict());
+        auto& dict = mpark::get<PyDict>(*result);
+        auto first = frame.values.end() - 2 * instr.arg;
+        for (auto it = first; it != frame.values.end(); it += 2) {
+          dict.set(std::move(it[0]), std::move(it[1]));
+        }
+        frame.values.erase(first, frame.values.end());
+        frame.values.push_back(std::move(result));
+        break;
+      }
+      case OpCode::build_tuple: {
+        auto base = frame.values.size() - instr.arg;
+        auto tuple = PyTuple(frame.values.data() + base, instr.arg);
+        frame.values.resize(base);
+        frame.values.push_back(std::make_shared<PyObj>(std::move(tuple)));
+        break;
+      }
+      case OpCode::unpack_sequence: {
+        auto value = pop(frame);
+        auto values = unpack(*value, instr.arg);
+        for (int i = instr.arg - 1; i >= 0; --i) {
+          frame.values.push_back(values[i]);
+        }
+        break;
+      }
+      case OpCode::list_append: {
+        auto value = pop(frame);
+        mpark::get<PyList>(*frame.values.back()).values.push_back(
+            std::move(value));
+        break;
+      }
+      case OpCode::binary_subscr: {
+        auto index = pop(frame);
+        auto value = pop(frame);
+        frame.values.push_back(subscript(*value, *index));
+        break;
+      }
+      case OpCode::store_subscr: {
+        auto index = pop(frame);
+        auto value = pop(frame);
+        store_subscript(*value, std::move(index), pop(frame));
+        break;
+      }
+      case OpCode::inplace_fast: {
+        auto& slot = frame.slots[instr.arg >> 4];
+        if (!slot) throw "Local variable referenced before assignment";
+        auto b = pop(frame);
+        inplace_op(static_cast<Op>(instr.arg & 0xf), slot, *b);
+        break;
+      }
+      case OpCode::inplace_deref: {
+        auto& value = frame.cells[instr.arg >> 4]->value;
+        if (!value) throw "Local variable referenced before assignment";
+        auto b = pop(frame);
+        inplace_op(static_cast<Op>(instr.arg & 0xf), value, *b);
+        break;
+      }
+      case OpCode::inplace_global: {
+        auto global = stack.globals.find(frame.code->names[instr.arg >> 4]);
+        if (global == stack.globals.end() || !global->second) {
+          throw "Name referenced before assignment";
+        }
+        auto b = pop(frame);
+        inplace_op(static_cast<Op>(instr.arg & 0xf), global->second, *b);
+        break;
+      }
+      case OpCode::inplace_subscr: {
+        auto b = pop(frame);
+        auto index = pop(frame);
+        auto value = pop(frame);
+        inplace_subscript(static_cast<Op>(instr.arg), *value, *index, *b);
+        break;
+      }
+      case OpCode::print_space:
+        frame.code->files[instr.arg]->put(' ');
+        break;
+      case OpCode::print_item:
+        print(*frame.code->files[instr.arg], *pop(frame));
+        break;
+      case OpCode::print_newline:
+        frame.code->files[instr.arg]->put('\n');
+        break;
+    }
+  }
+}
+
+auto run_guarded(std::vector<Frame>& frames, Stack& stack,
+                 VMOptions const& options) -> std::shared_ptr<PyObj> {
+  try {
+    return run_frames(frames, stack, options);
+  } catch (...) {
+    // A generator whose body raised cannot be resumed.
+    for (auto&& frame : frames) {
+      if (frame.generator) {
+        frame.generator->running = false;
+        frame.generator->finished = true;
+      }
+    }
+    throw;
+  }
+}
+}  // namespace
+
+auto make_frame(PyFunction& fun, std::shared_ptr<PyObj>* args, int argc)
+    -> Frame {
+  auto const& code = fun.code;
+
+  Frame frame;
+  frame.owner = code;
+  frame.code = code.get();
+  frame.slots.resize(code->nslots);
+  for (int i = 0; i < argc; ++i) frame.slots[i] = std::move(args[i]);
+
+  bool shared = !code->cell_slots.empty();
+  for (auto&& cell : fun.cells) shared = shared || cell;
+  if (shared) {
+    frame.cells.resize(code->nslots);
+    for (auto slot : code->cell_slots) {
+      frame.cells[slot] = std::make_shared<Cell>();
+      frame.cells[slot]->value = std::move(frame.slots[slot]);
+    }
+  }
+  for (int i = 0; i < fun.captures.size(); ++i) {
+    if (fun.cells[i]) {
+      frame.cells[code->nlocals + i] = fun.cells[i];
+    } else {
+      frame.slots[code->nlocals + i] = fun.captures[i];
+    }
+  }
+  return frame;
+}
+
+auto make_generator(PyFunction& fun, std::vector<std::shared_ptr<PyObj>>& args)
+    -> std::shared_ptr<Generator> {
+  if (!fun.code) fun.code = compile(fun.def);
+  auto gen = std::make_shared<Generator>();
+  gen->frame = make_frame(fun, args.data(), args.size());
+  return gen;
+}
+
+auto resume(std::shared_ptr<Generator> const& gen, Stack& stack,
+            VMOptions const& options) -> std::shared_ptr<PyObj> {
+  if (gen->finished) throw "StopIteration";
+  auto result = try_resume(gen, stack, options);
+  if (!result) throw "StopIteration";
+  return result;
+}
+
+auto try_resume(std::shared_ptr<Generator> const& gen, Stack& stack,
+                VMOptions const& options) -> std::shared_ptr<PyObj> {
+  if (gen->finished) return nullptr;
+  std::vector<Frame> frames;
+  push_resumed(frames, gen, options);
+  return run_guarded(frames, stack, options);
+}
+
+void execute(Code const& code, Stack& stack, VMOptions const& options) {
+  std::vector<Frame> frames(1);
+  frames.back().code = &code;
+  run_guarded(frames, stack, options);
+}
+
+void run(Module const& ast, Stack& stack, VMOptions const& options) {
+  auto code = compile(ast);
+  execute(*code, stack, options);
+}
+}  // namespace MyPython
@@ -20,6 +20,17 @@ template <class T, class... VTs>
 struct is_variant_member<T, mpark::variant<VTs...>>
     : public disjunction<std::is_same<T, VTs>...> {};
 
+// The index of T among the alternatives of Variant.
+template <class T, class Variant>
+struct variant_index;
+template <class T, class... VTs>
+struct variant_index<T, mpark::variant<T, VTs...>>
+    : std::integral_constant<std::size_t, 0> {};
+template <class T, class VT, class... VTs>
+struct variant_index<T, mpark::variant<VT, VTs...>>
+    : std::integral_constant<
+          std::size_t, 1 + variant_index<T, mpark::variant<VTs...>>::value> {};
+
 template <class... Funs>
 struct __visitor;
 
@@ -20,13 +20,13 @@ TEST_CASE("Evaluates bool operators properly", "[eval_expr]") {
   SECTION("Evalutes and properly") {
     bool_op.op = MyPython::BoolOperator::and_op;
     auto observed = *eval_expr(bool_op, stack);
-    REQUIRE(MyPython::cmp(observed, false) == 0);
+    REQUIRE(MyPython::str(observed).string() == "");
   }
 
   SECTION("Evalutes or properly") {
     bool_op.op = MyPython::BoolOperator::or_op;
     auto observed = *eval_expr(bool_op, stack);
-    REQUIRE(MyPython::cmp(observed, true) == 0);
+    REQUIRE(MyPython::str(observed).string() == "truthy");
   }
 }
 
@@ -119,19 +119,19 @@ TEST_CASE("Evalutes named constants", "[eval_expr]") {
   SECTION("Evaluates None literal") {
     nc.value = MyPython::Singleton::none;
     auto result = *eval_expr(nc, stack);
-    REQUIRE(MyPython::str(result).value == "None");
+    REQUIRE(MyPython::str(result).string() == "None");
   }
 
   SECTION("Evaluates True literal") {
     nc.value = MyPython::Singleton::true_value;
     auto result = *eval_expr(nc, stack);
-    REQUIRE(MyPython::str(result).value == "True");
+    REQUIRE(MyPython::str(result).string() == "True");
   }
 
   SECTION("Evaluates False literal") {
     nc.value = MyPython::Singleton::false_value;
     auto result = *eval_expr(nc, stack);
-    REQUIRE(MyPython::str(result).value == "False");
+    REQUIRE(MyPython::str(result).string() == "False");
   }
 }
 
@@ -310,3 +310,67 @@ TEST_CASE("Can print expressions", "[eval_stmt]") {
     REQUIRE(out.str() == "100 100 100\n");
   }
 }
+
+TEST_CASE("Calls functions", "[eval_expr]") {
+  MyPython::Name x;
+  x.id = "x";
+  MyPython::Name y;
+  y.id = "y";
+
+  MyPython::BinOp sum;
+  sum.left = std::make_shared<MyPython::Expression>(x);
+  sum.right = std::make_shared<MyPython::Expression>(y);
+
+  MyPython::Return ret;
+  ret.value = std::make_shared<MyPython::Expression>(sum);
+
+  MyPython::FunctionDef def;
+  def.name = "add";
+  def.args = {"x", "y"};
+  def.body = {ret};
+
+  MyPython::Name add;
+  add.id = "add";
+  MyPython::Num num;
+  num.n = 20;
+
+  MyPython::Call call;
+  call.func = std::make_shared<MyPython::Expression>(add);
+
+  MyPython::Stack stack;
+  MyPython::eval_stmt(def, stack);
+
+  SECTION("Binds arguments and returns the result") {
+    call.args = {num, num};
+    auto result = *eval_expr(call, stack);
+    REQUIRE(MyPython::cmp(result, 40) == 0);
+    REQUIRE(stack.locals.empty());
+    REQUIRE(stack.call_stack.empty());
+  }
+
+  SECTION("Returns None without a return statement") {
+    MyPython::Expr body;
+    body.value = std::make_shared<MyPython::Expression>(num);
+    def.body = {body};
+    MyPython::eval_stmt(def, stack);
+
+    call.args = {num, num};
+    auto result = *eval_expr(call, stack);
+    REQUIRE(MyPython::str(result).string() == "None");
+  }
+
+  SECTION("Returns None from a bare return") {
+    MyPython::Return bare;
+    def.body = {bare, ret};
+    MyPython::eval_stmt(def, stack);
+
+    call.args = {num, num};
+    auto result = *eval_expr(call, stack);
+    REQUIRE(MyPython::str(result).string() == "None");
+  }
+
+  SECTION("Rejects the wrong number of arguments") {
+    call.args = {num};
+    REQUIRE_THROWS([&] { eval_expr(call, stack); }());
+  }
+}
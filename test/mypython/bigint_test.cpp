@@ -0,0 +1,173 @@
+#include <climits>
+#include <string>
+
+#include <mypython/bigint.hpp>
+#include "catch.hpp"
+
+namespace {
+auto product(long lo, long hi) -> MyPython::PyObj {
+  if (lo == hi) return MyPython::PyInt(lo);
+  auto mid = lo + (hi - lo) / 2;
+  return MyPython::mul(product(lo, mid), product(mid + 1, hi));
+}
+}  // namespace
+
+TEST_CASE("Promotes overflowing ints to big ints", "[bigint]") {
+  MyPython::PyObj max = MyPython::PyInt(LONG_MAX);
+  MyPython::PyObj min = MyPython::PyInt(LONG_MIN);
+
+  SECTION("Adds past a word") {
+    auto sum = MyPython::add(max, MyPython::PyInt(1));
+    REQUIRE(MyPython::str(sum).string() == "9223372036854775808");
+    REQUIRE(MyPython::cmp(sum, max) > 0);
+    REQUIRE(MyPython::cmp(MyPython::sub(sum, MyPython::PyInt(1)), max) == 0);
+  }
+
+  SECTION("Subtracts past a word") {
+    auto diff = MyPython::sub(min, MyPython::PyInt(1));
+    REQUIRE(MyPython::str(diff).string() == "-9223372036854775809");
+    REQUIRE(MyPython::cmp(diff, min) < 0);
+  }
+
+  SECTION("Multiplies past a word") {
+    auto square = MyPython::mul(min, min);
+    REQUIRE(MyPython::str(square).string() ==
+            "85070591730234615865843651857942052864");
+    auto negated = MyPython::mul(square, MyPython::PyInt(-1));
+    REQUIRE(MyPython::str(negated).string() ==
+            "-85070591730234615865843651857942052864");
+  }
+
+  SECTION("Demotes results that fit again") {
+    auto big = MyPython::add(max, max);
+    auto back = mpark::get<MyPython::PyInt>(MyPython::sub(big, max));
+    REQUIRE(!back.big);
+    REQUIRE(back.value == LONG_MAX);
+    REQUIRE(!MyPython::truth_value(MyPython::sub(big, big)));
+  }
+}
+
+TEST_CASE("Multiplies large big ints", "[bigint]") {
+  // 1000! has over 250 limbs, so a product tree multiplies with Karatsuba
+  // while the running product multiplies by one small factor at a time.
+  MyPython::PyObj running = MyPython::PyInt(1);
+  for (long i = 1; i <= 1000; ++i) {
+    running = MyPython::mul(running, MyPython::PyInt(i));
+  }
+  auto tree = product(1, 1000);
+  REQUIRE(MyPython::cmp(running, tree) == 0);
+
+  auto digits = MyPython::str(tree).string();
+  REQUIRE(digits.size() == 2568);
+  REQUIRE(digits.substr(0, 10) == "4023872600");
+
+  // (n - 1)^2 = n^2 - 2n + 1
+  auto one = MyPython::PyInt(1);
+  auto less = MyPython::sub(tree, one);
+  auto expanded = MyPython::sub(MyPython::mul(tree, tree),
+                                MyPython::add(running, running));
+  REQUIRE(MyPython::cmp(MyPython::mul(less, less),
+                        MyPython::add(expanded, one)) == 0);
+}
+
+TEST_CASE("Applies integer operators with Python semantics", "[bigint]") {
+  using MyPython::Op;
+  using MyPython::PyInt;
+  auto eval = [](MyPython::PyObj const& a, Op op, MyPython::PyObj const& b) {
+    return MyPython::str(MyPython::binary_op(op, a, b)).string();
+  };
+  auto two_100 = MyPython::binary_op(Op::pow, PyInt(2), PyInt(100));
+  auto three_200 = MyPython::binary_op(Op::pow, PyInt(3), PyInt(200));
+  auto seven_50 = MyPython::binary_op(Op::pow, PyInt(-7), PyInt(50));
+
+  SECTION("Floors division and modulo") {
+    REQUIRE(eval(PyInt(7), Op::floor_div, PyInt(-2)) == "-4");
+    REQUIRE(eval(PyInt(7), Op::mod, PyInt(-2)) == "-1");
+    REQUIRE(eval(PyInt(-7), Op::floor_div, PyInt(2)) == "-4");
+    REQUIRE(eval(PyInt(-7), Op::mod, PyInt(2)) == "1");
+    REQUIRE(eval(PyInt(LONG_MIN), Op::floor_div, PyInt(-1)) ==
+            "9223372036854775808");
+    REQUIRE(eval(PyInt(LONG_MIN), Op::mod, PyInt(-1)) == "0");
+    REQUIRE_THROWS(eval(PyInt(1), Op::mod, PyInt(0)));
+
+    auto divisor = MyPython::sub(PyInt(0), seven_50);
+    REQUIRE(eval(three_200, Op::floor_div, divisor) ==
+            "-147689269781346654697366079240021362541982658661987021");
+    REQUIRE(eval(three_200, Op::mod, divisor) ==
+            "-755410807900735363553565675570880206995228");
+  }
+
+  SECTION("Raises to powers") {
+    REQUIRE(eval(PyInt(3), Op::pow, PyInt(40)) == "12157665459056928801");
+    REQUIRE(eval(PyInt(-2), Op::pow, PyInt(63)) == "-9223372036854775808");
+    REQUIRE(MyPython::str(two_100).string() ==
+            "1267650600228229401496703205376");
+    REQUIRE(MyPython::str(MyPython::pow_mod(PyInt(3), PyInt(200),
+                                            PyInt(1000000007)))
+                .string() == "136318165");
+    REQUIRE(MyPython::str(MyPython::pow_mod(PyInt(-3), PyInt(101),
+                                            PyInt(-1000)))
+                .string() == "-3");
+
+    auto exp = MyPython::add(
+        MyPython::binary_op(Op::pow, PyInt(2), PyInt(70)), PyInt(1));
+    auto m = MyPython::add(
+        MyPython::binary_op(Op::pow, PyInt(10), PyInt(30)), PyInt(7));
+    REQUIRE(MyPython::str(MyPython::pow_mod(two_100, exp, m)).string() ==
+            "61421404767959449662673843593");
+  }
+
+  SECTION("Raises to negative powers modulo an int") {
+    auto pow_mod = [](PyInt base, PyInt exp, PyInt m) {
+      return MyPython::str(MyPython::pow_mod(base, exp, m)).string();
+    };
+    REQUIRE(pow_mod(PyInt(3), PyInt(-1), PyInt(7)) == "5");
+    REQUIRE(pow_mod(PyInt(3), PyInt(-2), PyInt(7)) == "4");
+    REQUIRE(pow_mod(PyInt(-3), PyInt(-1), PyInt(7)) == "2");
+    REQUIRE(pow_mod(PyInt(3), PyInt(-1), PyInt(-7)) == "-2");
+    REQUIRE(pow_mod(PyInt(5), PyInt(-1), PyInt(1)) == "0");
+    REQUIRE_THROWS(pow_mod(PyInt(2), PyInt(-1), PyInt(4)));
+    REQUIRE_THROWS(pow_mod(PyInt(0), PyInt(-1), PyInt(7)));
+
+    // 2 ** 89 - 1 is prime, so 2 ** 100 is invertible modulo it.
+    auto prime =
+        MyPython::sub(MyPython::binary_op(Op::pow, PyInt(2), PyInt(89)),
+                      PyInt(1));
+    auto inverse = MyPython::pow_mod(two_100, PyInt(-1), prime);
+    REQUIRE(MyPython::str(MyPython::pow_mod(
+                              MyPython::binary_op(Op::mul, inverse, two_100),
+                              PyInt(1), prime))
+                .string() == "1");
+    REQUIRE_THROWS(MyPython::pow_mod(two_100, PyInt(-1), two_100));
+  }
+
+  SECTION("Shifts into and out of big ints") {
+    REQUIRE(MyPython::cmp(MyPython::binary_op(Op::lshift, PyInt(1),
+                                              PyInt(100)),
+                          two_100) == 0);
+    auto negative = MyPython::sub(PyInt(0), two_100);
+    REQUIRE(eval(negative, Op::rshift, PyInt(3)) ==
+            "-158456325028528675187087900672");
+    REQUIRE(eval(PyInt(-5), Op::rshift, PyInt(1)) == "-3");
+    REQUIRE(eval(PyInt(-1), Op::rshift, PyInt(200)) == "-1");
+    REQUIRE_THROWS(eval(PyInt(1), Op::lshift, PyInt(-1)));
+  }
+
+  SECTION("Combines bits in two's complement") {
+    auto two_64 = MyPython::binary_op(Op::pow, PyInt(2), PyInt(64));
+    auto two_80 = MyPython::binary_op(Op::pow, PyInt(2), PyInt(80));
+    auto two_70 = MyPython::binary_op(Op::pow, PyInt(2), PyInt(70));
+    auto two_90 = MyPython::binary_op(Op::pow, PyInt(2), PyInt(90));
+    auto three_50 = MyPython::binary_op(Op::pow, PyInt(3), PyInt(50));
+
+    REQUIRE(eval(MyPython::sub(two_100, PyInt(1)), Op::bit_and,
+                 MyPython::sub(PyInt(0), two_64)) ==
+            "1267650600209782657422993653760");
+    REQUIRE(eval(MyPython::sub(PyInt(0), two_80), Op::bit_or,
+                 MyPython::add(two_70, PyInt(5))) ==
+            "-1207745227993911763402747");
+    REQUIRE(eval(MyPython::sub(PyInt(0), three_50), Op::bit_xor, two_90) ==
+            "-1238657937273072127487894473");
+    REQUIRE(eval(PyInt(-6), Op::bit_and, PyInt(13)) == "8");
+  }
+}
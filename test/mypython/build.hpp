@@ -0,0 +1,233 @@
+#ifndef COSC4315HW2_TEST_MYPYTHON_BUILD_HPP_
+#define COSC4315HW2_TEST_MYPYTHON_BUILD_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <mypython/ast.hpp>
+
+// Shorthand for building ASTs in tests.
+namespace Build {
+using MyPython::Expression;
+using MyPython::Statement;
+
+inline auto name(std::string const& id) -> Expression {
+  MyPython::Name name;
+  name.id = id;
+  return name;
+}
+
+inline auto num(int n) -> Expression {
+  MyPython::Num num;
+  num.n = n;
+  return num;
+}
+
+inline auto str(std::string const& s) -> Expression {
+  MyPython::Str str;
+  str.s = s;
+  return str;
+}
+
+inline auto bool_op(Expression left, MyPython::BoolOperator op,
+                    Expression right) -> Expression {
+  MyPython::BoolOp bool_op;
+  bool_op.left = std::make_shared<Expression>(left);
+  bool_op.op = op;
+  bool_op.right = std::make_shared<Expression>(right);
+  return bool_op;
+}
+
+inline auto bin_op(Expression left, MyPython::Op op, Expression right)
+    -> Expression {
+  MyPython::BinOp bin_op;
+  bin_op.left = std::make_shared<Expression>(left);
+  bin_op.op = op;
+  bin_op.right = std::make_shared<Expression>(right);
+  return bin_op;
+}
+
+inline auto compare(Expression left, std::vector<MyPython::CmpOp> ops,
+                    std::vector<Expression> comparators) -> Expression {
+  MyPython::Compare compare;
+  compare.left = std::make_shared<Expression>(left);
+  compare.ops = ops;
+  compare.comparators = comparators;
+  return compare;
+}
+
+inline auto call(std::string const& fun, std::vector<Expression> args)
+    -> Expression {
+  MyPython::Call call;
+  call.func = std::make_shared<Expression>(name(fun));
+  call.args = args;
+  return call;
+}
+
+inline auto method(Expression self, std::string const& attr,
+                   std::vector<Expression> args) -> Expression {
+  MyPython::Attribute attribute;
+  attribute.value = std::make_shared<Expression>(self);
+  attribute.attr = attr;
+  MyPython::Call call;
+  call.func = std::make_shared<Expression>(attribute);
+  call.args = args;
+  return call;
+}
+
+inline auto list(std::vector<Expression> elts) -> Expression {
+  MyPython::List list;
+  list.elts = elts;
+  return list;
+}
+
+inline auto list_comp(Expression elt, std::string const& target,
+                      Expression iter, std::vector<Expression> ifs = {})
+    -> Expression {
+  MyPython::ListComp comp;
+  comp.elt = std::make_shared<Expression>(elt);
+  comp.target = std::make_shared<Expression>(name(target));
+  comp.iter = std::make_shared<Expression>(iter);
+  comp.ifs = ifs;
+  return comp;
+}
+
+inline auto dict(std::vector<Expression> keys, std::vector<Expression> values)
+    -> Expression {
+  MyPython::Dict dict;
+  dict.keys = keys;
+  dict.values = values;
+  return dict;
+}
+
+inline auto tuple(std::vector<Expression> elts) -> Expression {
+  MyPython::Tuple tuple;
+  tuple.elts = elts;
+  return tuple;
+}
+
+// a, b, ... = value.
+inline auto unpack(std::vector<Expression> targets, Expression value)
+    -> Statement {
+  MyPython::Assign assign;
+  assign.targets = {tuple(targets)};
+  assign.value = std::make_shared<Expression>(value);
+  return assign;
+}
+
+// first = second = ... = value.
+inline auto assign_all(std::vector<Expression> targets, Expression value)
+    -> Statement {
+  MyPython::Assign assign;
+  assign.targets = targets;
+  assign.value = std::make_shared<Expression>(value);
+  return assign;
+}
+
+inline auto subscript(Expression value, Expression index) -> Expression {
+  MyPython::Subscript sub;
+  sub.value = std::make_shared<Expression>(value);
+  sub.index = std::make_shared<Expression>(index);
+  return sub;
+}
+
+inline auto yield(Expression value) -> Expression {
+  MyPython::Yield yield;
+  yield.value = std::make_shared<Expression>(value);
+  return yield;
+}
+
+inline auto assign(std::string const& target, Expression value) -> Statement {
+  MyPython::Assign assign;
+  assign.targets = {name(target)};
+  assign.value = std::make_shared<Expression>(value);
+  return assign;
+}
+
+// target op= value.
+inline auto aug_assign(Expression target, MyPython::Op op, Expression value)
+    -> Statement {
+  MyPython::AugAssign aug;
+  aug.target = std::make_shared<Expression>(target);
+  aug.op = op;
+  aug.value = std::make_shared<Expression>(value);
+  return aug;
+}
+
+// value[index] = item.
+inline auto store(Expression value, Expression index, Expression item)
+    -> Statement {
+  MyPython::Assign assign;
+  assign.targets = {subscript(value, index)};
+  assign.value = std::make_shared<Expression>(item);
+  return assign;
+}
+
+inline auto ret(Expression value) -> Statement {
+  MyPython::Return ret;
+  ret.value = std::make_shared<Expression>(value);
+  return ret;
+}
+
+inline auto expr(Expression value) -> Statement {
+  MyPython::Expr expr;
+  expr.value = std::make_shared<Expression>(value);
+  return expr;
+}
+
+inline auto if_stmt(Expression test, std::vector<Statement> body,
+                    std::vector<Statement> or_else = {}) -> Statement {
+  MyPython::If if_stmt;
+  if_stmt.test = std::make_shared<Expression>(test);
+  if_stmt.body = body;
+  if_stmt.or_else = or_else;
+  return if_stmt;
+}
+
+inline auto while_stmt(Expression test, std::vector<Statement> body,
+                       std::vector<Statement> or_else = {}) -> Statement {
+  MyPython::While loop;
+  loop.test = std::make_shared<Expression>(test);
+  loop.body = body;
+  loop.or_else = or_else;
+  return loop;
+}
+
+inline auto for_stmt(std::string const& target, Expression iter,
+                     std::vector<Statement> body,
+                     std::vector<Statement> or_else = {}) -> Statement {
+  MyPython::For loop;
+  loop.target = std::make_shared<Expression>(name(target));
+  loop.iter = std::make_shared<Expression>(iter);
+  loop.body = body;
+  loop.or_else = or_else;
+  return loop;
+}
+
+inline auto def(std::string const& fun, std::vector<std::string> args,
+                std::vector<Statement> body) -> Statement {
+  MyPython::FunctionDef def;
+  def.name = fun;
+  def.args = args;
+  def.body = body;
+  return def;
+}
+
+// Frees a deep expression tree without recursing through its destructors.
+inline void release(std::shared_ptr<Expression> root) {
+  std::vector<std::shared_ptr<Expression>> pending = {root};
+  root.reset();
+  while (!pending.empty()) {
+    auto expr = std::move(pending.back());
+    pending.pop_back();
+    auto bin_op = mpark::get_if<MyPython::BinOp>(expr.get());
+    if (bin_op != nullptr && expr.use_count() == 1) {
+      pending.push_back(std::move(bin_op->left));
+      pending.push_back(std::move(bin_op->right));
+    }
+  }
+}
+}  // namespace Build
+
+#endif
@@ -0,0 +1,151 @@
+#include <cmath>
+#include <string>
+
+#include <mypython/bigint.hpp>
+#include <mypython/vm.hpp>
+#include "catch.hpp"
+#include "mypython/build.hpp"
+
+namespace {
+auto text(MyPython::PyObj const& obj) -> std::string {
+  return MyPython::str(obj).string();
+}
+
+auto obj(MyPython::PyObj value) -> std::shared_ptr<MyPython::PyObj> {
+  return std::make_shared<MyPython::PyObj>(std::move(value));
+}
+}  // namespace
+
+TEST_CASE("Hashes equal numbers equally", "[dict]") {
+  using MyPython::hash;
+  using MyPython::PyFloat;
+  using MyPython::PyInt;
+
+  MyPython::PyBool yes;
+  yes.value = true;
+  REQUIRE(hash(PyInt(1)) == hash(PyFloat(1.0)));
+  REQUIRE(hash(PyInt(1)) == hash(yes));
+  REQUIRE(hash(PyInt(-7)) == hash(PyFloat(-7.0)));
+  REQUIRE(hash(PyInt(-1)) == hash(PyInt(-2)));
+  REQUIRE(hash(PyFloat(0.5)) != hash(PyInt(0)));
+
+  auto big = MyPython::make_int(MyPython::pow(MyPython::make_bigint(2), 70));
+  REQUIRE(big.big);
+  REQUIRE(hash(big) == hash(PyFloat(std::ldexp(1.0, 70))));
+  // 2**61 - 1 is the modulus.
+  auto const modulus = (1L << 61) - 1;
+  REQUIRE(hash(PyInt(modulus)) == 0);
+  REQUIRE(hash(PyInt(modulus + 5)) == 5);
+
+  REQUIRE_THROWS(hash(MyPython::PyList()));
+  REQUIRE_THROWS(hash(MyPython::PyDict()));
+}
+
+TEST_CASE("Keeps dict entries in insertion order", "[dict]") {
+  MyPython::PyDict d;
+  REQUIRE(d.get(MyPython::PyInt(1)) == nullptr);
+
+  for (long i = 0; i < 1000; ++i) {
+    d.set(obj(MyPython::PyStr("key" + std::to_string(i))),
+          obj(MyPython::PyInt(i)));
+    if (i == 4) REQUIRE(d.index_width() == 1);
+    if (i == 200) REQUIRE(d.index_width() == 2);
+  }
+  REQUIRE(d.size() == 1000);
+  for (long i = 0; i < 1000; ++i) {
+    auto value = d.get(MyPython::PyStr("key" + std::to_string(i)));
+    REQUIRE(value != nullptr);
+    REQUIRE(MyPython::cmp(*value, i) == 0);
+    REQUIRE(text(*d.entries()[i].key) == "key" + std::to_string(i));
+  }
+  REQUIRE(d.get(MyPython::PyStr("key1000")) == nullptr);
+  REQUIRE(d.get(MyPython::PyInt(3)) == nullptr);
+
+  // Replacing a value keeps the key's position.
+  d.set(obj(MyPython::PyStr("key0")), obj(MyPython::PyStr("zero")));
+  REQUIRE(d.size() == 1000);
+  REQUIRE(text(*d.entries().front().value) == "zero");
+
+  MyPython::PyDict numbers;
+  numbers.set(obj(MyPython::PyInt(1)), obj(MyPython::PyStr("int")));
+  numbers.set(obj(MyPython::PyFloat(1.0)), obj(MyPython::PyStr("float")));
+  numbers.set(obj(MyPython::PyStr("1")), obj(MyPython::PyStr("str")));
+  REQUIRE(numbers.size() == 2);
+  REQUIRE(text(numbers) == "{1: 'float', '1': 'str'}");
+}
+
+TEST_CASE("Counts with dicts", "[dict][run][eval_ast]") {
+  using namespace Build;
+  using MyPython::CmpOp;
+  using MyPython::Op;
+
+  auto word = subscript(name("words"), bin_op(name("i"), Op::mod, num(3)));
+  MyPython::Module module;
+  module.body = {
+      assign("words", list({str("a"), str("b"), str("a")})),
+      assign("counts", dict({}, {})),
+      for_stmt("i", call("range", {num(10)}),
+               {assign("w", word),
+                store(name("counts"), name("w"),
+                      bin_op(method(name("counts"), "get", {name("w"), num(0)}),
+                             Op::add, num(1)))}),
+      assign("a", subscript(name("counts"), str("a"))),
+      assign("n", call("len", {name("counts")})),
+      assign("has", compare(str("b"), {CmpOp::in}, {name("counts")})),
+      assign("missing", method(name("counts"), "get", {str("c")})),
+      assign("keys", list_comp(name("k"), "k", name("counts"))),
+      assign("literal", dict({str("x"), num(2)}, {num(1), list({})})),
+  };
+
+  MyPython::Stack stack;
+
+  SECTION("On the tree-walker") { MyPython::eval_ast(module, stack); }
+  SECTION("On the VM") { MyPython::run(module, stack); }
+
+  auto const& globals = stack.globals;
+  REQUIRE(text(*globals.at("counts")) == "{'a': 7, 'b': 3}");
+  REQUIRE(text(*globals.at("a")) == "7");
+  REQUIRE(text(*globals.at("n")) == "2");
+  REQUIRE(MyPython::truth_value(*globals.at("has")));
+  REQUIRE(text(*globals.at("missing")) == "None");
+  REQUIRE(text(*globals.at("keys")) == "['a', 'b']");
+  REQUIRE(text(*globals.at("literal")) == "{'x': 1, 2: []}");
+
+  MyPython::Module missing;
+  missing.body = {expr(subscript(name("counts"), str("c")))};
+  REQUIRE_THROWS([&] { MyPython::run(missing, stack); }());
+  MyPython::Module unhashable;
+  unhashable.body = {store(name("counts"), list({}), num(1))};
+  REQUIRE_THROWS([&] { MyPython::eval_ast(unhashable, stack); }());
+}
+
+TEST_CASE("Benchmarks counting by key", "[.][benchmark]") {
+  using namespace Build;
+  using MyPython::Op;
+
+  std::vector<Expression> tags;
+  for (int i = 0; i < 1000; ++i) tags.push_back(str("tag" + std::to_string(i)));
+
+  auto tag = subscript(name("tags"), bin_op(bin_op(name("i"), Op::mul,
+                                                    num(7919)),
+                                            Op::mod, num(1000)));
+  MyPython::Module module;
+  module.body = {
+      def("count", {"tags", "n"},
+          {assign("counts", dict({}, {})),
+           for_stmt("i", call("range", {name("n")}),
+                    {assign("t", tag),
+                     store(name("counts"), name("t"),
+                           bin_op(method(name("counts"), "get",
+                                         {name("t"), num(0)}),
+                                  Op::add, num(1)))}),
+           ret(name("counts"))}),
+      assign("counts", call("count", {list(tags), num(1000000)})),
+  };
+
+  BENCHMARK("Count 1000000 records over 1000 string keys") {
+    MyPython::Stack stack;
+    MyPython::run(module, stack);
+    REQUIRE(MyPython::length(*stack.globals.at("counts")) == 1000);
+  }
+}
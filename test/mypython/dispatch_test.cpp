@@ -0,0 +1,85 @@
+#include <vector>
+
+#include <mypython/ast.hpp>
+#include "catch.hpp"
+
+namespace {
+auto make_bool(bool value) -> MyPython::PyObj {
+  MyPython::PyBool b;
+  b.value = value;
+  return b;
+}
+
+// The dispatch binary_op replaced: a visit into the kernel overloads, with a
+// throwing fallback for unsupported pairs.
+template <class T1, class T2>
+auto visit_add(T1 const&, T2 const&) -> MyPython::PyObj {
+  throw "Cannot add two types";
+}
+
+auto visit_add(MyPython::PyInt const& a, MyPython::PyInt const& b)
+    -> MyPython::PyObj {
+  return MyPython::add(a, b);
+}
+
+auto visit_add(MyPython::PyStr const& a, MyPython::PyStr const& b)
+    -> MyPython::PyObj {
+  return MyPython::add(a, b);
+}
+
+auto visit_add(MyPython::PyObj const& a, MyPython::PyObj const& b)
+    -> MyPython::PyObj {
+  auto visitor = [](auto&& a, auto&& b) { return visit_add(a, b); };
+  return mpark::visit(visitor, a, b);
+}
+}  // namespace
+
+TEST_CASE("Promotes bools in binary operators", "[binary_op]") {
+  using MyPython::Op;
+  using MyPython::PyInt;
+  auto t = make_bool(true);
+  auto f = make_bool(false);
+
+  REQUIRE(MyPython::cmp(MyPython::binary_op(Op::add, t, PyInt(1)), 2) == 0);
+  REQUIRE(MyPython::cmp(MyPython::binary_op(Op::sub, PyInt(1), t), 0) == 0);
+  REQUIRE(MyPython::cmp(MyPython::binary_op(Op::add, t, t), 2) == 0);
+  REQUIRE(MyPython::cmp(t, PyInt(1)) == 0);
+  REQUIRE(MyPython::cmp(f, t) < 0);
+  REQUIRE(MyPython::truth_value(t));
+
+  auto both = MyPython::binary_op(Op::bit_and, t, f);
+  REQUIRE(mpark::holds_alternative<MyPython::PyBool>(both));
+  REQUIRE(MyPython::str(both).string() == "False");
+  auto either = MyPython::binary_op(Op::bit_or, t, PyInt(2));
+  REQUIRE(MyPython::str(either).string() == "3");
+
+  auto repeated =
+      MyPython::binary_op(Op::mul, MyPython::PyStr("ab"), make_bool(true));
+  REQUIRE(MyPython::str(repeated).string() == "ab");
+
+  REQUIRE_THROWS(MyPython::binary_op(Op::add, MyPython::PyStr("a"), t));
+  REQUIRE_THROWS(MyPython::cmp(MyPython::PyStr("a"), t));
+}
+
+TEST_CASE("Benchmarks binary operator dispatch", "[.][benchmark]") {
+  std::vector<MyPython::PyObj> values;
+  for (long i = 0; i < 1000; ++i) values.push_back(MyPython::PyInt(i));
+
+  BENCHMARK("Type-tag table") {
+    MyPython::PyObj sum = MyPython::PyInt(0);
+    for (int n = 0; n < 1000; ++n) {
+      for (auto&& value : values) {
+        sum = MyPython::binary_op(MyPython::Op::add, sum, value);
+      }
+    }
+    REQUIRE(MyPython::cmp(sum, 499500000) == 0);
+  }
+
+  BENCHMARK("Variant visit") {
+    MyPython::PyObj sum = MyPython::PyInt(0);
+    for (int n = 0; n < 1000; ++n) {
+      for (auto&& value : values) sum = visit_add(sum, value);
+    }
+    REQUIRE(MyPython::cmp(sum, 499500000) == 0);
+  }
+}
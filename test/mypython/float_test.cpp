@@ -0,0 +1,71 @@
+#include <cmath>
+#include <string>
+
+#include <mypython/ast.hpp>
+#include "catch.hpp"
+
+namespace {
+auto text(MyPython::PyObj const& obj) -> std::string {
+  return MyPython::str(obj).string();
+}
+}  // namespace
+
+TEST_CASE("Applies float operators with Python semantics", "[float]") {
+  using MyPython::PyFloat;
+  using MyPython::PyInt;
+
+  SECTION("Divides ints into floats") {
+    auto half = MyPython::div(PyInt(7), PyInt(2));
+    REQUIRE(mpark::holds_alternative<PyFloat>(half));
+    REQUIRE(text(half) == "3.5");
+    REQUIRE(text(MyPython::div(PyInt(1), PyInt(3))) == "0.3333333333333333");
+    REQUIRE(text(MyPython::div(PyInt(-6), PyInt(3))) == "-2.0");
+    REQUIRE_THROWS(MyPython::div(PyInt(1), PyInt(0)));
+
+    auto big = MyPython::pow(PyInt(10), PyInt(30));
+    REQUIRE(text(MyPython::div(big, PyInt(4))) == "2.5e+29");
+    REQUIRE(text(MyPython::div(PyInt(1), big)) == "1e-30");
+  }
+
+  SECTION("Promotes mixed operands") {
+    auto f = MyPython::div(PyInt(1), PyInt(2));
+    REQUIRE(text(MyPython::add(f, PyInt(1))) == "1.5");
+    REQUIRE(text(MyPython::mul(PyInt(3), f)) == "1.5");
+    REQUIRE(text(MyPython::pow(PyInt(2), PyInt(-1))) == "0.5");
+    REQUIRE(text(MyPython::pow(f, PyInt(2))) == "0.25");
+    REQUIRE_THROWS(MyPython::pow(PyInt(0), PyInt(-1)));
+  }
+
+  SECTION("Floors division and takes the divisor's sign") {
+    MyPython::PyObj a = PyFloat(-7.5);
+    MyPython::PyObj b = PyFloat(2);
+    REQUIRE(text(MyPython::floor_div(a, b)) == "-4.0");
+    REQUIRE(text(MyPython::mod(a, b)) == "0.5");
+    REQUIRE(text(MyPython::mod(PyFloat(7.5), PyFloat(-2))) == "-0.5");
+    REQUIRE(text(MyPython::mod(PyFloat(4), PyFloat(-2))) == "-0.0");
+    REQUIRE_THROWS(MyPython::mod(a, PyFloat(0)));
+    REQUIRE_THROWS(MyPython::floor_div(a, PyInt(0)));
+  }
+
+  SECTION("Compares ints and floats exactly") {
+    auto two53 = MyPython::pow(PyInt(2), PyInt(53));
+    auto above = MyPython::add(two53, PyInt(1));
+    auto f = MyPython::PyObj(PyFloat(9007199254740992.0));
+    REQUIRE(MyPython::cmp(two53, f) == 0);
+    REQUIRE(MyPython::cmp(above, f) > 0);
+    REQUIRE(MyPython::cmp(f, above) < 0);
+
+    auto big = MyPython::pow(PyInt(10), PyInt(30));
+    REQUIRE(MyPython::cmp(big, PyFloat(1e30)) < 0);
+    REQUIRE(MyPython::cmp(PyFloat(0.5), PyInt(0)) > 0);
+    REQUIRE(MyPython::cmp(PyFloat(-0.5), PyInt(0)) < 0);
+  }
+
+  SECTION("Treats NaN as unordered") {
+    MyPython::PyObj nan = PyFloat(std::nan(""));
+    REQUIRE_FALSE(MyPython::compare_op(MyPython::CmpOp::eq, nan, nan));
+    REQUIRE(MyPython::compare_op(MyPython::CmpOp::eq_not, nan, nan));
+    REQUIRE_FALSE(MyPython::compare_op(MyPython::CmpOp::lt, nan, PyInt(1)));
+    REQUIRE_FALSE(MyPython::compare_op(MyPython::CmpOp::gt_eq, PyInt(1), nan));
+  }
+}
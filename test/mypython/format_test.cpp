@@ -0,0 +1,99 @@
+#include <climits>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include <mypython/ast.hpp>
+#include <mypython/format.hpp>
+#include "catch.hpp"
+
+namespace {
+auto repeat(char c, int n) -> std::string { return std::string(n, c); }
+}  // namespace
+
+TEST_CASE("Formats floats as Python's repr", "[format_float]") {
+  using MyPython::format_float;
+  REQUIRE(format_float(0.1) == "0.1");
+  REQUIRE(format_float(1.0 / 3) == "0.3333333333333333");
+  REQUIRE(format_float(2.5) == "2.5");
+  REQUIRE(format_float(1e15) == "1000000000000000.0");
+  REQUIRE(format_float(1e16) == "1e+16");
+  REQUIRE(format_float(123456789e10) == "1.23456789e+18");
+  REQUIRE(format_float(0.0001) == "0.0001");
+  REQUIRE(format_float(1e-05) == "1e-05");
+  REQUIRE(format_float(1.5e-07) == "1.5e-07");
+  REQUIRE(format_float(5e-324) == "5e-324");
+  REQUIRE(format_float(1.7976931348623157e308) == "1.7976931348623157e+308");
+  REQUIRE(format_float(-0.0) == "-0.0");
+  REQUIRE(format_float(std::numeric_limits<double>::infinity()) == "inf");
+  REQUIRE(format_float(-std::numeric_limits<double>::infinity()) == "-inf");
+  REQUIRE(format_float(std::nan("")) == "nan");
+}
+
+TEST_CASE("Formats ints in decimal", "[format_int]") {
+  using MyPython::format_int;
+  REQUIRE(format_int(0) == "0");
+  REQUIRE(format_int(7) == "7");
+  REQUIRE(format_int(10) == "10");
+  REQUIRE(format_int(-99) == "-99");
+  REQUIRE(format_int(100) == "100");
+  REQUIRE(format_int(1234567) == "1234567");
+  REQUIRE(format_int(LONG_MAX) == "9223372036854775807");
+  REQUIRE(format_int(LONG_MIN) == "-9223372036854775808");
+
+  char buffer[8];
+  REQUIRE(std::string(buffer, MyPython::format_padded(42, 5, buffer)) ==
+          "00042");
+
+  SECTION("Splits big ints") {
+    using MyPython::PyInt;
+    auto power = MyPython::pow(PyInt(10), PyInt(3000));
+    REQUIRE(MyPython::str(power).string() == "1" + repeat('0', 3000));
+    REQUIRE(MyPython::str(MyPython::sub(power, PyInt(1))).string() ==
+            repeat('9', 3000));
+
+    auto seven = MyPython::str(MyPython::pow(PyInt(7), PyInt(3000))).string();
+    REQUIRE(seven.size() == 2536);
+    REQUIRE(seven.substr(0, 20) == "19684303057677623685");
+    REQUIRE(seven.substr(2516) == "35187432273841800001");
+
+    auto three =
+        MyPython::sub(PyInt(0), MyPython::pow(PyInt(3), PyInt(20000)));
+    auto digits = MyPython::str(three).string();
+    REQUIRE(digits.size() == 9544);
+    REQUIRE(digits.substr(0, 20) == "-2661303427217419791");
+    REQUIRE(digits.substr(9524) == "08807535253104400001");
+    int sum = 0;
+    for (auto c : digits.substr(1)) sum += c - '0';
+    REQUIRE(sum == 42426);
+  }
+}
+
+TEST_CASE("Prints values without building strings", "[print]") {
+  std::ostringstream out;
+  MyPython::print(out, MyPython::PyInt(-120));
+  MyPython::print(out, MyPython::PyFloat(0.5));
+  MyPython::print(out, MyPython::PyStr("x"));
+  MyPython::print(out, MyPython::pow(MyPython::PyInt(2), MyPython::PyInt(64)));
+  MyPython::print(out, MyPython::PyNoneType());
+  REQUIRE(out.str() == "-1200.5x18446744073709551616None");
+}
+
+TEST_CASE("Benchmarks printing ints", "[.][benchmark]") {
+  BENCHMARK("print") {
+    std::ostringstream out;
+    for (long i = 0; i < 1000000; ++i) {
+      MyPython::print(out, MyPython::PyInt(i * 7919));
+      out.put('\n');
+    }
+  }
+
+  BENCHMARK("std::to_string") {
+    std::ostringstream out;
+    for (long i = 0; i < 1000000; ++i) {
+      MyPython::PyObj value = MyPython::PyInt(i * 7919);
+      out << std::to_string(mpark::get<MyPython::PyInt>(value).value) << "\n";
+    }
+  }
+}
@@ -0,0 +1,130 @@
+#include <mypython/inliner.hpp>
+#include <mypython/vm.hpp>
+#include "catch.hpp"
+#include "mypython/build.hpp"
+
+TEST_CASE("Inlines small leaf functions", "[inline_functions]") {
+  using namespace Build;
+  using MyPython::Op;
+
+  MyPython::Module module;
+  module.body = {
+      def("square", {"x"}, {ret(bin_op(name("x"), Op::mul, name("x")))}),
+      def("scale", {"x"},
+          {assign("y", bin_op(name("x"), Op::mul, num(3))),
+           ret(bin_op(name("y"), Op::add, num(1)))}),
+      def("fact", {"n"}, {ret(bin_op(name("n"), Op::mul, call("fact", {})))}),
+      def("apply", {"square"}, {ret(call("square", {num(2)}))}),
+      def("scaled", {},
+          {ret(call("scale", {bin_op(num(2), Op::add, num(3))}))}),
+      assign("a", call("square", {num(7)})),
+      assign("b", call("scaled", {})),
+      assign("c", call("scale", {bin_op(num(2), Op::add, num(3))})),
+  };
+
+  MyPython::InlineReport report;
+
+  SECTION("Substitutes bodies and preserves results") {
+    auto inlined = MyPython::inline_functions(module, report);
+    REQUIRE(report.inlined.size() == 2);
+    REQUIRE(report.inlined[0].callee == "scale");
+    REQUIRE(report.inlined[0].caller == "scaled");
+    REQUIRE(report.inlined[1].callee == "square");
+    REQUIRE(report.inlined[1].caller == "<module>");
+
+    auto const& a = mpark::get<MyPython::Assign>(inlined.body[5]);
+    REQUIRE(mpark::holds_alternative<MyPython::BinOp>(*a.value));
+
+    MyPython::Stack stack;
+    MyPython::eval_ast(inlined, stack);
+    REQUIRE(MyPython::cmp(*stack.globals.at("a"), 49) == 0);
+    REQUIRE(MyPython::cmp(*stack.globals.at("b"), 16) == 0);
+    REQUIRE(MyPython::cmp(*stack.globals.at("c"), 16) == 0);
+
+    // The callee's locals never become globals.
+    MyPython::Stack plain;
+    MyPython::eval_ast(module, plain);
+    REQUIRE(stack.globals.size() == plain.globals.size());
+    for (auto&& global : stack.globals) {
+      REQUIRE(global.first.find('$') == std::string::npos);
+    }
+  }
+
+  SECTION("Reports functions that were not inlined") {
+    MyPython::inline_functions(module, report);
+    REQUIRE(report.rejected.at("fact") == "recursive");
+    REQUIRE(report.rejected.count("apply") == 1);
+  }
+
+  SECTION("Leaves calls to shadowed names alone") {
+    auto inlined = MyPython::inline_functions(module, report);
+    auto const& apply = mpark::get<MyPython::FunctionDef>(inlined.body[3]);
+    auto const& body = mpark::get<MyPython::Return>(apply.body.front());
+    REQUIRE(mpark::holds_alternative<MyPython::Call>(*body.value));
+  }
+
+  SECTION("Respects the size threshold") {
+    MyPython::InlineOptions options;
+    options.max_size = 4;
+    MyPython::inline_functions(module, report, options);
+    REQUIRE(report.inlined.size() == 1);
+    REQUIRE(report.rejected.at("scale") == "too large (over 4 nodes)");
+  }
+}
+
+TEST_CASE("Inlines calls inside deep expressions", "[inline_functions]") {
+  using namespace Build;
+
+  int const depth = 100000;
+  auto one = std::make_shared<MyPython::Expression>(num(1));
+  bool left = true;
+  SECTION("Left-nested chains") { left = true; }
+  SECTION("Right-nested chains") { left = false; }
+
+  // A chain of ones for a callee too large to inline, and the same chain
+  // around a call that is inlined.
+  auto ones = one;
+  auto sum =
+      std::make_shared<MyPython::Expression>(call("square", {num(2)}));
+  for (int i = 1; i < depth; ++i) {
+    MyPython::BinOp bin_op;
+    bin_op.left = left ? ones : one;
+    bin_op.right = left ? one : ones;
+    ones = std::make_shared<MyPython::Expression>(bin_op);
+    bin_op.left = left ? sum : one;
+    bin_op.right = left ? one : sum;
+    sum = std::make_shared<MyPython::Expression>(bin_op);
+  }
+
+  MyPython::Return large;
+  large.value = ones;
+  MyPython::Return sum_ret;
+  sum_ret.value = sum;
+  MyPython::Module module;
+  module.body = {
+      def("square", {"x"},
+          {ret(bin_op(name("x"), MyPython::Op::mul, name("x")))}),
+      def("large", {}, {large}), def("f", {}, {sum_ret}),
+      assign("x", call("f", {}))};
+
+  MyPython::InlineReport report;
+  auto inlined = MyPython::inline_functions(module, report);
+  REQUIRE(report.inlined.size() == 1);
+  REQUIRE(report.inlined[0].caller == "f");
+  REQUIRE(report.rejected.at("large") == "too large (over 24 nodes)");
+
+  MyPython::Stack stack;
+  MyPython::run(inlined, stack);
+  REQUIRE(MyPython::cmp(*stack.globals.at("x"), depth + 3) == 0);
+
+  stack.globals.clear();
+  for (int i : {1, 2}) {
+    auto& def = mpark::get<MyPython::FunctionDef>(inlined.body[i]);
+    release(std::move(mpark::get<MyPython::Return>(def.body.front()).value));
+  }
+  module.body.clear();
+  large.value.reset();
+  sum_ret.value.reset();
+  release(std::move(ones));
+  release(std::move(sum));
+}
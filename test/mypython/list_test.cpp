@@ -0,0 +1,113 @@
+#include <sstream>
+#include <string>
+
+#include <mypython/vm.hpp>
+#include "catch.hpp"
+#include "mypython/build.hpp"
+
+namespace {
+auto text(MyPython::PyObj const& obj) -> std::string {
+  return MyPython::str(obj).string();
+}
+}  // namespace
+
+TEST_CASE("Builds, indexes and appends to lists", "[list][run][eval_ast]") {
+  using namespace Build;
+  using MyPython::CmpOp;
+  using MyPython::Op;
+
+  MyPython::Module module;
+  module.body = {
+      assign("xs", list({num(1), str("two"), num(3)})),
+      assign("first", subscript(name("xs"), num(0))),
+      assign("last", subscript(name("xs"), num(-1))),
+      store(name("xs"), num(1), num(2)),
+      expr(method(name("xs"), "append", {num(4)})),
+      assign("n", call("len", {name("xs")})),
+      assign("squares", list_comp(bin_op(name("i"), Op::mul, name("i")), "i",
+                                  call("range", {num(5)}))),
+      assign("odd", list_comp(name("x"), "x", name("xs"),
+                              {bin_op(name("x"), Op::mod, num(2))})),
+      assign("both", bin_op(name("odd"), Op::add, name("squares"))),
+      assign("has", compare(num(16), {CmpOp::in}, {name("squares")})),
+      assign("lacks", compare(num(5), {CmpOp::in}, {name("squares")})),
+      assign("seen", list({})),
+      for_stmt("v", name("xs"),
+               {expr(method(name("seen"), "append", {name("v")}))}),
+      assign("same", compare(name("seen"), {CmpOp::eq}, {name("xs")})),
+      assign("less", compare(list({num(1), num(2)}), {CmpOp::lt},
+                             {list({num(1), num(2), num(0)})})),
+      assign("nested", list({list({}), str("it's"), str("a\n")})),
+  };
+
+  MyPython::Stack stack;
+
+  SECTION("On the tree-walker") { MyPython::eval_ast(module, stack); }
+  SECTION("On the VM") { MyPython::run(module, stack); }
+
+  auto const& globals = stack.globals;
+  REQUIRE(text(*globals.at("first")) == "1");
+  REQUIRE(text(*globals.at("last")) == "3");
+  REQUIRE(text(*globals.at("xs")) == "[1, 2, 3, 4]");
+  REQUIRE(text(*globals.at("n")) == "4");
+  REQUIRE(text(*globals.at("squares")) == "[0, 1, 4, 9, 16]");
+  REQUIRE(text(*globals.at("odd")) == "[1, 3]");
+  REQUIRE(text(*globals.at("both")) == "[1, 3, 0, 1, 4, 9, 16]");
+  REQUIRE(MyPython::truth_value(*globals.at("has")));
+  REQUIRE(!MyPython::truth_value(*globals.at("lacks")));
+  REQUIRE(MyPython::truth_value(*globals.at("same")));
+  REQUIRE(MyPython::truth_value(*globals.at("less")));
+  REQUIRE(text(*globals.at("nested")) == "[[], \"it's\", 'a\\n']");
+
+  // The comprehension over range() allocated its buffer once.
+  auto const& squares = mpark::get<MyPython::PyList>(*globals.at("squares"));
+  REQUIRE(squares.values.capacity() == 5);
+}
+
+TEST_CASE("Rejects bad list operations", "[list][run]") {
+  using namespace Build;
+
+  MyPython::Stack stack;
+  auto fails = [&](MyPython::Statement stmt) {
+    MyPython::Module module;
+    module.body = {assign("xs", list({num(1)})), stmt};
+    REQUIRE_THROWS([&] { MyPython::run(module, stack); }());
+    REQUIRE_THROWS([&] { MyPython::eval_ast(module, stack); }());
+  };
+
+  fails(expr(subscript(name("xs"), num(1))));
+  fails(expr(subscript(name("xs"), num(-2))));
+  fails(expr(subscript(name("xs"), str("0"))));
+  fails(store(name("xs"), num(5), num(0)));
+  fails(store(str("abc"), num(0), num(0)));
+  fails(expr(method(name("xs"), "push", {num(1)})));
+  fails(expr(call("len", {num(1)})));
+}
+
+TEST_CASE("Benchmarks building lists", "[.][benchmark]") {
+  using namespace Build;
+  using MyPython::Op;
+
+  auto square = bin_op(name("i"), Op::mul, name("i"));
+  MyPython::Module appended;
+  appended.body = {
+      assign("xs", list({})),
+      for_stmt("i", call("range", {num(1000000)}),
+               {expr(method(name("xs"), "append", {square}))}),
+  };
+  MyPython::Module comprehension;
+  comprehension.body = {
+      assign("xs", list_comp(square, "i", call("range", {num(1000000)}))),
+  };
+
+  BENCHMARK("xs.append(i * i) for 1000000 values") {
+    MyPython::Stack stack;
+    MyPython::run(appended, stack);
+    REQUIRE(MyPython::length(*stack.globals.at("xs")) == 1000000);
+  }
+  BENCHMARK("[i * i for i in range(1000000)]") {
+    MyPython::Stack stack;
+    MyPython::run(comprehension, stack);
+    REQUIRE(MyPython::length(*stack.globals.at("xs")) == 1000000);
+  }
+}
@@ -0,0 +1,84 @@
+#include <mypython/scope.hpp>
+#include "catch.hpp"
+#include "mypython/build.hpp"
+
+TEST_CASE("Resolves function scopes", "[resolve_scope]") {
+  MyPython::Name a;
+  a.id = "a";
+  MyPython::Name g;
+  g.id = "g";
+  MyPython::Name t;
+  t.id = "t";
+
+  MyPython::BinOp sum;
+  sum.left = std::make_shared<MyPython::Expression>(a);
+  sum.right = std::make_shared<MyPython::Expression>(g);
+
+  MyPython::Assign assign;
+  assign.targets = {t};
+  assign.value = std::make_shared<MyPython::Expression>(sum);
+
+  MyPython::Return ret;
+  ret.value = std::make_shared<MyPython::Expression>(t);
+
+  MyPython::FunctionDef def;
+  def.name = "f";
+  def.args = {"a", "b"};
+  def.body = {assign, ret};
+
+  auto scope = MyPython::resolve_scope(def);
+
+  SECTION("Places parameters before other locals") {
+    REQUIRE(scope.locals == std::vector<std::string>{"a", "b", "t"});
+    REQUIRE(MyPython::slot_of(scope, "b") == 1);
+    REQUIRE(MyPython::slot_of(scope, "g") == -1);
+  }
+
+  SECTION("Collects names read from outside") {
+    REQUIRE(scope.free == std::vector<std::string>{"g"});
+  }
+
+  SECTION("Collects free names of nested functions") {
+    MyPython::Name h;
+    h.id = "h";
+    MyPython::Return inner_ret;
+    inner_ret.value = std::make_shared<MyPython::Expression>(h);
+
+    MyPython::FunctionDef inner;
+    inner.name = "inner";
+    inner.body = {inner_ret};
+    def.body.insert(def.body.begin(), inner);
+
+    scope = MyPython::resolve_scope(def);
+    REQUIRE(MyPython::is_local(scope, "inner"));
+    REQUIRE(MyPython::is_free(scope, "h"));
+  }
+}
+
+TEST_CASE("Finds captured variables that need cells", "[resolve_scope]") {
+  using namespace Build;
+
+  auto sum = bin_op(name("a"), MyPython::Op::add, name("b"));
+  auto getter = def("get", {}, {ret(sum)});
+  MyPython::FunctionDef def;
+  def.name = "f";
+  def.args = {"a"};
+
+  SECTION("Copies variables bound once before capture") {
+    def.body = {assign("b", num(1)), getter};
+    auto scope = MyPython::resolve_scope(def);
+    REQUIRE(scope.cells.empty());
+  }
+
+  SECTION("Shares variables rebound after capture") {
+    def.body = {assign("b", num(1)), getter, assign("b", num(2))};
+    auto scope = MyPython::resolve_scope(def);
+    REQUIRE(scope.cells == std::vector<std::string>{"b"});
+  }
+
+  SECTION("Shares variables first bound after capture") {
+    def.body = {getter, assign("b", num(1))};
+    auto scope = MyPython::resolve_scope(def);
+    REQUIRE(scope.cells == std::vector<std::string>{"b"});
+  }
+}
@@ -0,0 +1,140 @@
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <mypython/search.hpp>
+#include <mypython/vm.hpp>
+#include "catch.hpp"
+#include "mypython/build.hpp"
+
+namespace {
+using Find = std::size_t (*)(char const*, std::size_t, char const*,
+                             std::size_t);
+
+auto finders() -> std::vector<Find> {
+  std::vector<Find> result = {MyPython::find_scalar, MyPython::find};
+#if defined(__x86_64__) || defined(__i386__)
+  result.push_back(MyPython::find_sse2);
+  if (MyPython::has_avx2()) result.push_back(MyPython::find_avx2);
+#endif
+  return result;
+}
+
+auto expected(std::string const& haystack, std::string const& needle)
+    -> std::size_t {
+  auto pos = haystack.find(needle);
+  return pos == std::string::npos ? MyPython::not_found : pos;
+}
+}  // namespace
+
+TEST_CASE("Finds substrings with every search", "[search]") {
+  for (auto find : finders()) {
+    REQUIRE(find("abc", 3, "", 0) == 0);
+    REQUIRE(find("", 0, "a", 1) == MyPython::not_found);
+    REQUIRE(find("ab", 2, "abc", 3) == MyPython::not_found);
+    REQUIRE(find("xxab", 4, "b", 1) == 3);
+
+    // Matches across and at the ends of 16 and 32 byte blocks.
+    for (std::size_t length = 1; length < 100; ++length) {
+      for (std::size_t at = 0; at + length <= 100; at += 7) {
+        auto haystack = std::string(100, 'a');
+        auto needle = std::string(length, 'a');
+        needle.front() = 'b';
+        needle.back() = 'c';
+        haystack.replace(at, length, needle);
+        REQUIRE(find(haystack.data(), haystack.size(), needle.data(),
+                     needle.size()) == at);
+      }
+    }
+
+    // Small alphabets give many partial matches.
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> letter(0, 2);
+    std::uniform_int_distribution<int> size(0, 200);
+    for (int trial = 0; trial < 2000; ++trial) {
+      std::string haystack(size(rng), ' ');
+      for (auto& c : haystack) c = 'a' + letter(rng);
+      std::string needle(1 + size(rng) % 6, ' ');
+      for (auto& c : needle) c = 'a' + letter(rng);
+      REQUIRE(find(haystack.data(), haystack.size(), needle.data(),
+                   needle.size()) == expected(haystack, needle));
+    }
+  }
+}
+
+TEST_CASE("Evaluates membership and identity", "[run][eval_ast]") {
+  using namespace Build;
+  using MyPython::CmpOp;
+
+  auto none = [] {
+    MyPython::NameConstant none;
+    none.value = MyPython::Singleton::none;
+    return Expression(none);
+  };
+
+  MyPython::Module module;
+  module.body = {
+      assign("line", str("level=warn code=E42 message=disk full")),
+      assign("a", compare(str("E42"), {CmpOp::in}, {name("line")})),
+      assign("b", compare(str("E43"), {CmpOp::in}, {name("line")})),
+      assign("c", compare(str("E43"), {CmpOp::not_in}, {name("line")})),
+      assign("d", compare(str(""), {CmpOp::in}, {name("line")})),
+      assign("alias", name("line")),
+      assign("e", compare(name("alias"), {CmpOp::is}, {name("line")})),
+      assign("f", compare(str("x y"), {CmpOp::is}, {str("x y")})),
+      assign("g", compare(name("f"), {CmpOp::is_not}, {none()})),
+      assign("h", compare(none(), {CmpOp::is}, {none()})),
+  };
+
+  MyPython::Stack stack;
+
+  SECTION("On the tree-walker") { MyPython::eval_ast(module, stack); }
+  SECTION("On the VM") { MyPython::run(module, stack); }
+
+  auto truthy = [&](char const* name) {
+    return MyPython::truth_value(*stack.globals.at(name));
+  };
+  REQUIRE(truthy("a"));
+  REQUIRE_FALSE(truthy("b"));
+  REQUIRE(truthy("c"));
+  REQUIRE(truthy("d"));
+  REQUIRE(truthy("e"));
+  REQUIRE_FALSE(truthy("f"));
+  REQUIRE(truthy("g"));
+  REQUIRE(truthy("h"));
+
+  REQUIRE_THROWS(MyPython::compare_op(CmpOp::in, MyPython::PyInt(1),
+                                      MyPython::PyStr("1")));
+  REQUIRE_THROWS(MyPython::compare_op(CmpOp::in, MyPython::PyStr("1"),
+                                      MyPython::PyInt(1)));
+}
+
+TEST_CASE("Benchmarks substring search", "[.][benchmark]") {
+  // A 4 MB log line whose marker sits at the very end, among many near
+  // misses.
+  std::string haystack;
+  while (haystack.size() < (4 << 20)) haystack += "ts=1 level=info MARK ";
+  haystack += "MARKER";
+  std::string const needle = "MARKER";
+  auto const at = haystack.size() - needle.size();
+
+  auto run = [&](Find find) {
+    REQUIRE(find(haystack.data(), haystack.size(), needle.data(),
+                  needle.size()) == at);
+  };
+
+  BENCHMARK("Naive loop") {
+    std::size_t pos = 0;
+    while (haystack.compare(pos, needle.size(), needle) != 0) ++pos;
+    REQUIRE(pos == at);
+  }
+  BENCHMARK("std::string::find") { REQUIRE(haystack.find(needle) == at); }
+  BENCHMARK("Scalar") { run(MyPython::find_scalar); }
+#if defined(__x86_64__) || defined(__i386__)
+  BENCHMARK("SSE2") { run(MyPython::find_sse2); }
+  if (MyPython::has_avx2()) {
+    BENCHMARK("AVX2") { run(MyPython::find_avx2); }
+  }
+#endif
+}
@@ -0,0 +1,285 @@
+#include <string>
+#include <vector>
+
+#include <mypython/vm.hpp>
+#include "catch.hpp"
+#include "mypython/build.hpp"
+
+namespace {
+auto repeat(MyPython::PyObj const& a, MyPython::PyObj const& b)
+    -> std::string {
+  return MyPython::str(MyPython::binary_op(MyPython::Op::mul, a, b)).string();
+}
+}  // namespace
+
+TEST_CASE("Holds strings compactly and shares long ones", "[str]") {
+  using MyPython::PyStr;
+
+  PyStr empty;
+  REQUIRE(empty.empty());
+  REQUIRE(empty.ascii());
+  REQUIRE(empty.string().empty());
+
+  auto const long_text = std::string(100, 'x');
+  PyStr small("short");
+  PyStr big(long_text);
+  REQUIRE(small.size() == 5);
+  REQUIRE(small.string() == "short");
+  REQUIRE(big.size() == 100);
+  REQUIRE(big.string() == long_text);
+
+  SECTION("Copies share the buffer of long strings") {
+    auto copy = big;
+    REQUIRE(copy.data() == big.data());
+    REQUIRE(copy.same_buffer(big));
+    REQUIRE(MyPython::cmp(copy, big) == 0);
+    REQUIRE_FALSE(PyStr(long_text).same_buffer(big));
+  }
+
+  SECTION("Appends without touching shared copies") {
+    auto copy = big;
+    copy.append(small);
+    REQUIRE(copy.string() == long_text + "short");
+    REQUIRE(big.string() == long_text);
+
+    auto inline_copy = small;
+    inline_copy.append(inline_copy);
+    REQUIRE(inline_copy.string() == "shortshort");
+    REQUIRE(small.string() == "short");
+
+    for (int i = 0; i < 10; ++i) inline_copy.append(inline_copy);
+    REQUIRE(inline_copy.size() == 10240);
+    REQUIRE(inline_copy.string().substr(10230) == "shortshort");
+  }
+
+  SECTION("Caches hashes that agree with equality") {
+    REQUIRE(big.hash() == PyStr(long_text).hash());
+    REQUIRE(small.hash() == PyStr("short").hash());
+    REQUIRE(small.hash() != PyStr("shorts").hash());
+
+    auto grown = small;
+    auto before = grown.hash();
+    grown.append(PyStr("er"));
+    REQUIRE(grown.hash() != before);
+    REQUIRE(grown.hash() == PyStr("shorter").hash());
+  }
+
+  SECTION("Tracks whether every byte is ASCII") {
+    PyStr accented("caf\xc3\xa9");
+    REQUIRE_FALSE(accented.ascii());
+    REQUIRE(big.ascii());
+
+    auto joined = big;
+    joined.append(accented);
+    REQUIRE_FALSE(joined.ascii());
+    REQUIRE(MyPython::str(MyPython::mul(accented, MyPython::PyInt(3)))
+                .string() == "caf\xc3\xa9" "caf\xc3\xa9" "caf\xc3\xa9");
+    REQUIRE_FALSE(mpark::get<PyStr>(MyPython::mul(accented, 3)).ascii());
+  }
+
+  SECTION("Counts code points") {
+    PyStr accented("caf\xc3\xa9");
+    REQUIRE(accented.length() == 4);
+    REQUIRE(big.length() == 100);
+
+    // Appending in place recounts a buffer's cached length.
+    auto grown = accented.repeat(10);
+    REQUIRE(grown.length() == 40);
+    grown.append(accented);
+    REQUIRE(grown.length() == 44);
+    grown.append(accented);
+    REQUIRE(grown.length() == 48);
+    REQUIRE(grown.offset(47) == 58);
+    REQUIRE(grown.next(58) == 60);
+  }
+
+  SECTION("Orders by bytes") {
+    REQUIRE(MyPython::cmp(PyStr("abc"), PyStr("abd")) < 0);
+    REQUIRE(MyPython::cmp(PyStr("ab"), PyStr("abc")) < 0);
+    REQUIRE(MyPython::cmp(PyStr("b"), PyStr("abc")) > 0);
+    REQUIRE(MyPython::cmp(PyStr(long_text + "a"), PyStr(long_text)) > 0);
+  }
+}
+
+TEST_CASE("Interns identifier-like literals", "[str]") {
+  using MyPython::PyStr;
+
+  auto a = MyPython::literal_str("status_ok");
+  auto b = MyPython::literal_str("status_ok");
+  REQUIRE(a.interned());
+  REQUIRE(a.same_buffer(b));
+  REQUIRE(MyPython::equal(a, b));
+  REQUIRE(MyPython::cmp(a, b) == 0);
+
+  auto other = MyPython::literal_str("status_bad");
+  REQUIRE(other.interned());
+  REQUIRE_FALSE(MyPython::equal(a, other));
+  REQUIRE(MyPython::cmp(a, other) > 0);
+
+  // Built strings are not interned but still compare by content.
+  auto built = MyPython::add(PyStr("status_"), PyStr("ok"));
+  REQUIRE_FALSE(mpark::get<PyStr>(built).interned());
+  REQUIRE(MyPython::compare_op(MyPython::CmpOp::eq, built, a));
+  REQUIRE(MyPython::compare_op(MyPython::CmpOp::eq_not, built, other));
+
+  REQUIRE_FALSE(MyPython::literal_str("two words").interned());
+  REQUIRE(MyPython::literal_str("two words").string() == "two words");
+
+  // Appending leaves the interned copy alone.
+  auto grown = a;
+  grown.append(PyStr("!"));
+  REQUIRE_FALSE(grown.interned());
+  REQUIRE(grown.string() == "status_ok!");
+  REQUIRE(MyPython::literal_str("status_ok").string() == "status_ok");
+}
+
+TEST_CASE("Repeats strings", "[str]") {
+  using MyPython::PyInt;
+  using MyPython::PyStr;
+
+  REQUIRE(repeat(PyStr("ab"), PyInt(3)) == "ababab");
+  REQUIRE(repeat(PyInt(3), PyStr("ab")) == "ababab");
+  REQUIRE(repeat(PyStr("-"), PyInt(1000)) == std::string(1000, '-'));
+  REQUIRE(repeat(PyStr("abc"), PyInt(1)) == "abc");
+  REQUIRE(repeat(PyStr("abc"), PyInt(0)).empty());
+  REQUIRE(repeat(PyStr("abc"), PyInt(-2)).empty());
+  REQUIRE(repeat(PyStr(""), PyInt(5)).empty());
+
+  auto big = MyPython::pow(PyInt(2), PyInt(100));
+  REQUIRE(repeat(PyStr(""), big).empty());
+  REQUIRE(repeat(PyStr("a"), MyPython::sub(PyInt(0), big)).empty());
+  REQUIRE_THROWS(repeat(PyStr("a"), big));
+
+  auto seven = repeat(PyStr("abc"), PyInt(7));
+  REQUIRE(seven.size() == 21);
+  REQUIRE(seven.substr(18) == "abc");
+}
+
+TEST_CASE("Appends to strings nothing else holds", "[run][eval_ast]") {
+  using namespace Build;
+  using MyPython::Op;
+
+  MyPython::Module module;
+  module.body = {
+      def("f", {},
+          {assign("s", str("a")),
+           assign("s", bin_op(name("s"), Op::add, str("b"))),
+           assign("t", name("s")),
+           assign("s", bin_op(name("s"), Op::add, str("c"))),
+           ret(bin_op(bin_op(name("t"), Op::add, str("|")), Op::add,
+                      name("s")))}),
+      assign("g", call("f", {})),
+      assign("h", call("f", {})),
+      assign("x", str("p")),
+      assign("x", bin_op(name("x"), Op::add, str("q"))),
+      assign("y", name("x")),
+      assign("x", bin_op(name("x"), Op::add, str("r"))),
+      assign("x", bin_op(name("x"), Op::add, name("x"))),
+  };
+
+  MyPython::Stack stack;
+
+  SECTION("On the tree-walker") { MyPython::eval_ast(module, stack); }
+  SECTION("On the VM") { MyPython::run(module, stack); }
+
+  // Constants and other bindings of a string are never appended to.
+  REQUIRE(MyPython::str(*stack.globals.at("g")).string() == "ab|abc");
+  REQUIRE(MyPython::str(*stack.globals.at("h")).string() == "ab|abc");
+  REQUIRE(MyPython::str(*stack.globals.at("x")).string() == "pqrpqr");
+  REQUIRE(MyPython::str(*stack.globals.at("y")).string() == "pq");
+}
+
+TEST_CASE("Indexes and iterates strings by code point",
+          "[str][run][eval_ast]") {
+  using namespace Build;
+  using MyPython::Op;
+
+  // "naive" with a diaeresis, a space, a euro sign and a four-byte snake.
+  auto const text = "na\xc3\xafve \xe2\x82\xac\xf0\x9f\x90\x8d";
+  MyPython::Module module;
+  module.body = {
+      assign("s", str(text)),
+      assign("n", call("len", {name("s")})),
+      assign("long_n", call("len", {bin_op(name("s"), Op::mul, num(3))})),
+      assign("i", subscript(name("s"), num(2))),
+      assign("euro", subscript(name("s"), num(6))),
+      assign("snake", subscript(name("s"), num(-1))),
+      assign("reversed", str("")),
+      for_stmt("c", name("s"),
+               {assign("reversed", bin_op(name("c"), Op::add,
+                                          name("reversed")))}),
+      assign("chars", list_comp(name("c"), "c", name("s"))),
+      assign("last", subscript(name("chars"), num(7))),
+  };
+
+  MyPython::Stack stack;
+
+  SECTION("On the tree-walker") { MyPython::eval_ast(module, stack); }
+  SECTION("On the VM") { MyPython::run(module, stack); }
+
+  auto global = [&](std::string const& id) {
+    return MyPython::str(*stack.globals.at(id)).string();
+  };
+  REQUIRE(global("n") == "8");
+  REQUIRE(global("long_n") == "24");
+  REQUIRE(global("i") == "\xc3\xaf");
+  REQUIRE(global("euro") == "\xe2\x82\xac");
+  REQUIRE(global("snake") == "\xf0\x9f\x90\x8d");
+  REQUIRE(global("reversed") ==
+          "\xf0\x9f\x90\x8d\xe2\x82\xac ev\xc3\xaf" "an");
+  REQUIRE(global("last") == "\xf0\x9f\x90\x8d");
+  REQUIRE(MyPython::length(*stack.globals.at("chars")) == 8);
+
+  module.body = {assign("out", subscript(name("s"), num(8)))};
+  REQUIRE_THROWS(MyPython::run(module, stack));
+}
+
+TEST_CASE("Benchmarks string repetition", "[.][benchmark]") {
+  BENCHMARK("\"x\" * 10000000") {
+    auto line = repeat(MyPython::PyStr("x"), MyPython::PyInt(10000000));
+    REQUIRE(line.size() == 10000000);
+  }
+}
+
+TEST_CASE("Benchmarks string equality", "[.][benchmark]") {
+  std::vector<MyPython::PyObj> interned;
+  std::vector<MyPython::PyObj> copied;
+  for (auto tag : {"pending", "running", "succeeded", "failed", "cancelled",
+                   "retrying", "skipped", "timed_out"}) {
+    interned.push_back(MyPython::literal_str(tag));
+    copied.push_back(MyPython::PyStr(tag));
+  }
+
+  auto count_matches = [](std::vector<MyPython::PyObj> const& tags) {
+    int matches = 0;
+    for (int n = 0; n < 100000; ++n) {
+      for (auto&& a : tags) {
+        for (auto&& b : tags) {
+          matches += MyPython::compare_op(MyPython::CmpOp::eq, a, b);
+        }
+      }
+    }
+    return matches;
+  };
+
+  BENCHMARK("Interned") { REQUIRE(count_matches(interned) == 800000); }
+  BENCHMARK("Not interned") { REQUIRE(count_matches(copied) == 800000); }
+}
+
+TEST_CASE("Benchmarks string concatenation", "[.][benchmark]") {
+  using namespace Build;
+  using MyPython::Op;
+
+  MyPython::Module module;
+  module.body = {
+      assign("s", str("")),
+      for_stmt("i", call("range", {num(20000)}),
+               {assign("s", bin_op(name("s"), Op::add, str("fragment ")))}),
+  };
+
+  BENCHMARK("s = s + piece, 20000 times") {
+    MyPython::Stack stack;
+    MyPython::run(module, stack);
+    REQUIRE(MyPython::str(*stack.globals.at("s")).string().size() == 180000);
+  }
+}
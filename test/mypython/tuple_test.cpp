@@ -0,0 +1,243 @@
+#include <string>
+
+#include <mypython/vm.hpp>
+#include "catch.hpp"
+#include "mypython/build.hpp"
+
+namespace {
+auto text(MyPython::PyObj const& obj) -> std::string {
+  return MyPython::str(obj).string();
+}
+
+auto obj(MyPython::PyObj value) -> std::shared_ptr<MyPython::PyObj> {
+  return std::make_shared<MyPython::PyObj>(std::move(value));
+}
+}  // namespace
+
+TEST_CASE("Recycles small tuples", "[tuple]") {
+  using MyPython::PyTuple;
+
+  std::shared_ptr<MyPython::PyObj> const* first = nullptr;
+  {
+    PyTuple pair = {obj(MyPython::PyInt(1)), obj(MyPython::PyInt(2))};
+    first = pair.begin();
+    PyTuple copy = pair;
+    REQUIRE(copy.begin() == pair.begin());
+  }
+  PyTuple again = {obj(MyPython::PyStr("a")), obj(MyPython::PyStr("b"))};
+  REQUIRE(again.begin() == first);
+  REQUIRE(text(again) == "('a', 'b')");
+
+  REQUIRE(PyTuple().begin() == nullptr);
+  REQUIRE(text(PyTuple()) == "()");
+  REQUIRE(text(PyTuple({obj(MyPython::PyInt(1))})) == "(1,)");
+
+  // Tuples are hashable, unless they hold something that is not.
+  MyPython::PyDict d;
+  d.set(obj(PyTuple({obj(MyPython::PyInt(1)), obj(MyPython::PyFloat(2.0))})),
+        obj(MyPython::PyStr("found")));
+  auto key = PyTuple({obj(MyPython::PyFloat(1.0)), obj(MyPython::PyInt(2))});
+  REQUIRE(d.get(key) != nullptr);
+  REQUIRE_THROWS(MyPython::hash(PyTuple({obj(MyPython::PyList())})));
+}
+
+TEST_CASE("Returns and unpacks tuples", "[tuple][run][eval_ast]") {
+  using namespace Build;
+  using MyPython::CmpOp;
+  using MyPython::Op;
+
+  MyPython::Module module;
+  module.body = {
+      def("divmod_", {"a", "b"},
+          {ret(tuple({bin_op(name("a"), Op::floor_div, name("b")),
+                      bin_op(name("a"), Op::mod, name("b"))}))}),
+      unpack({name("q"), name("r")}, call("divmod_", {num(17), num(5)})),
+      assign("t", tuple({num(1), tuple({str("x"), num(2)})})),
+      unpack({name("one"), tuple({name("x"), name("two")})}, name("t")),
+      assign("joined",
+             bin_op(tuple({num(1)}), Op::add, tuple({num(2), num(3)}))),
+      assign("pairs",
+             list({tuple({str("a"), num(1)}), tuple({str("b"), num(2)})})),
+      assign("total", num(0)),
+      for_stmt("p", name("pairs"),
+               {unpack({name("k"), name("v")}, name("p")),
+                assign("total", bin_op(name("total"), Op::add, name("v")))}),
+      assign("keys",
+             list_comp(subscript(name("p"), num(0)), "p", name("pairs"))),
+      assign("sum", num(0)),
+      for_stmt("e", name("joined"),
+               {assign("sum", bin_op(name("sum"), Op::add, name("e")))}),
+      assign("doubled",
+             list_comp(bin_op(name("e"), Op::mul, num(2)), "e",
+                       tuple({num(1), num(2), num(3)}))),
+      assign("less", compare(tuple({num(1), num(2)}), {CmpOp::lt},
+                             {tuple({num(1), num(3)})})),
+      assign("has", compare(num(3), {CmpOp::in}, {name("joined")})),
+      assign("n", call("len", {name("joined")})),
+  };
+
+  MyPython::Stack stack;
+
+  SECTION("On the tree-walker") { MyPython::eval_ast(module, stack); }
+  SECTION("On the VM") { MyPython::run(module, stack); }
+
+  auto const& globals = stack.globals;
+  REQUIRE(text(*globals.at("q")) == "3");
+  REQUIRE(text(*globals.at("r")) == "2");
+  REQUIRE(text(*globals.at("t")) == "(1, ('x', 2))");
+  REQUIRE(text(*globals.at("x")) == "x");
+  REQUIRE(text(*globals.at("two")) == "2");
+  REQUIRE(text(*globals.at("k")) == "b");
+  REQUIRE(text(*globals.at("total")) == "3");
+  REQUIRE(text(*globals.at("keys")) == "['a', 'b']");
+  REQUIRE(text(*globals.at("sum")) == "6");
+  REQUIRE(text(*globals.at("doubled")) == "[2, 4, 6]");
+  REQUIRE(text(*globals.at("joined")) == "(1, 2, 3)");
+  REQUIRE(MyPython::truth_value(*globals.at("less")));
+  REQUIRE(MyPython::truth_value(*globals.at("has")));
+  REQUIRE(text(*globals.at("n")) == "3");
+
+  MyPython::Module too_many;
+  too_many.body = {unpack({name("a"), name("b")}, name("joined"))};
+  REQUIRE_THROWS([&] { MyPython::run(too_many, stack); }());
+  REQUIRE_THROWS([&] { MyPython::eval_ast(too_many, stack); }());
+  MyPython::Module not_a_sequence;
+  not_a_sequence.body = {unpack({name("a"), name("b")}, num(1))};
+  REQUIRE_THROWS([&] { MyPython::run(not_a_sequence, stack); }());
+}
+
+TEST_CASE("Assigns to several targets", "[tuple][run][eval_ast]") {
+  using namespace Build;
+  using MyPython::CmpOp;
+
+  MyPython::Module module;
+  module.body = {
+      assign_all({name("a"), name("b")}, list({})),
+      expr(method(name("a"), "append", {num(1)})),
+      assign("same", compare(name("a"), {CmpOp::is}, {name("b")})),
+      assign("x", num(1)),
+      assign("y", num(2)),
+      assign("z", num(3)),
+      unpack({name("x"), name("y"), name("z")},
+             tuple({name("y"), name("z"), name("x")})),
+      def("swap", {"p", "q"},
+          {unpack({name("p"), name("q")}, tuple({name("q"), name("p")})),
+           ret(tuple({name("p"), name("q")}))}),
+      assign("swapped", call("swap", {num(1), str("s")})),
+      unpack({name("m"), name("m")}, tuple({num(1), num(2)})),
+      assign_all({name("u"), tuple({name("v"), name("w")})},
+                 tuple({num(4), num(5)})),
+      assign("l", list({num(0), num(0)})),
+      unpack({subscript(name("l"), num(0)), subscript(name("l"), num(1))},
+             tuple({num(7), num(8)})),
+  };
+
+  MyPython::Stack stack;
+
+  SECTION("On the tree-walker") { MyPython::eval_ast(module, stack); }
+  SECTION("On the VM") { MyPython::run(module, stack); }
+
+  auto const& globals = stack.globals;
+  REQUIRE(text(*globals.at("b")) == "[1]");
+  REQUIRE(text(*globals.at("same")) == "True");
+  REQUIRE(text(*globals.at("x")) == "2");
+  REQUIRE(text(*globals.at("y")) == "3");
+  REQUIRE(text(*globals.at("z")) == "1");
+  REQUIRE(text(*globals.at("swapped")) == "('s', 1)");
+  REQUIRE(text(*globals.at("m")) == "2");
+  REQUIRE(text(*globals.at("u")) == "(4, 5)");
+  REQUIRE(text(*globals.at("w")) == "5");
+  REQUIRE(text(*globals.at("l")) == "[7, 8]");
+}
+
+TEST_CASE("Swaps locals without a tuple", "[tuple][compile]") {
+  using namespace Build;
+
+  auto def = mpark::get<MyPython::FunctionDef>(Build::def(
+      "swap", {"p", "q"},
+      {unpack({name("p"), name("q")}, tuple({name("q"), name("p")})),
+       ret(name("p"))}));
+  auto code = MyPython::compile(def);
+  REQUIRE(code->instrs.front().op == MyPython::OpCode::swap_fast);
+  for (auto&& instr : code->instrs) {
+    REQUIRE(instr.op != MyPython::OpCode::build_tuple);
+  }
+}
+
+TEST_CASE("Swaps locals past slot 0x7fff", "[tuple][run]") {
+  using namespace Build;
+  using MyPython::OpCode;
+
+  MyPython::Module module;
+  module.body = {def("swap", {},
+                     {assign("p", num(1)), assign("q", num(2)),
+                      unpack({name("p"), name("q")},
+                             tuple({name("q"), name("p")})),
+                      ret(tuple({name("p"), name("q")}))})};
+  MyPython::Stack stack;
+  MyPython::run(module, stack);
+
+  // Moves p and q to slots 0x7fff and 0x8000, the first whose shift into the
+  // upper half of the argument overflows an int, rather than compiling a
+  // function with that many locals.
+  auto& fun = mpark::get<MyPython::PyFunction>(*stack.globals.at("swap"));
+  auto code = std::make_shared<MyPython::Code>(*fun.code);
+  code->nlocals = code->nslots = 0x8001;
+  for (auto& instr : code->instrs) {
+    if (instr.op == OpCode::load_fast || instr.op == OpCode::store_fast) {
+      instr.arg += 0x7fff;
+    } else if (instr.op == OpCode::swap_fast) {
+      instr.arg = static_cast<int>(0x7fffu | 0x8000u << 16);
+    }
+  }
+  fun.code = code;
+
+  module.body = {assign("result", call("swap", {}))};
+  MyPython::run(module, stack);
+  REQUIRE(text(*stack.globals.at("result")) == "(2, 1)");
+}
+
+TEST_CASE("Benchmarks returning pairs", "[.][benchmark]") {
+  using namespace Build;
+  using MyPython::Op;
+
+  MyPython::Module module;
+  module.body = {
+      def("step", {"a", "b"}, {ret(tuple({name("b"), name("a")}))}),
+      def("run", {"n"},
+          {unpack({name("a"), name("b")}, tuple({num(0), num(1)})),
+           for_stmt("i", call("range", {name("n")}),
+                    {unpack({name("a"), name("b")},
+                            call("step", {name("a"), name("b")}))}),
+           ret(bin_op(name("a"), Op::sub, name("b")))}),
+      assign("result", call("run", {num(1000000)})),
+  };
+
+  BENCHMARK("a, b = step(a, b) 1000000 times") {
+    MyPython::Stack stack;
+    MyPython::run(module, stack);
+    REQUIRE(MyPython::cmp(*stack.globals.at("result"), 1) == 0);
+  }
+}
+
+TEST_CASE("Benchmarks swapping locals", "[.][benchmark]") {
+  using namespace Build;
+  using MyPython::Op;
+
+  MyPython::Module module;
+  module.body = {
+      def("run", {"n"},
+          {unpack({name("a"), name("b")}, tuple({num(0), num(1)})),
+           for_stmt("i", call("range", {name("n")}),
+                    {unpack({name("a"), name("b")},
+                            tuple({name("b"), name("a")}))}),
+           ret(bin_op(name("a"), Op::sub, name("b")))}),
+      assign("result", call("run", {num(1000000)})),
+  };
+
+  BENCHMARK("a, b = b, a 1000000 times") {
+    MyPython::Stack stack;
+    MyPython::run(module, stack);
+    REQUIRE(MyPython::cmp(*stack.globals.at("result"), -1) == 0);
+  }
+}
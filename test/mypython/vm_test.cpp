@@ -0,0 +1,724 @@
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+#include <mypython/vm.hpp>
+#include "catch.hpp"
+#include "mypython/build.hpp"
+
+TEST_CASE("Runs modules on the VM", "[run]") {
+  using namespace Build;
+  using MyPython::Op;
+
+  std::stringstream out;
+  MyPython::Print print;
+  print.file = &out;
+  print.objects = {name("a"), call("twice", {str("ab")})};
+
+  MyPython::Module module;
+  module.body = {
+      def("twice", {"s"}, {ret(bin_op(name("s"), Op::add, name("s")))}),
+      assign("a", bin_op(num(6), Op::mul, num(7))),
+      if_stmt(compare(name("a"), {MyPython::CmpOp::gt}, {num(40)}),
+              {assign("b", num(1))}, {assign("b", num(2))}),
+      print,
+  };
+
+  MyPython::Stack stack;
+  MyPython::run(module, stack);
+
+  REQUIRE(MyPython::cmp(*stack.globals.at("a"), 42) == 0);
+  REQUIRE(MyPython::cmp(*stack.globals.at("b"), 1) == 0);
+  REQUIRE(out.str() == "42 abab\n");
+}
+
+TEST_CASE("Evaluates deep expressions on the VM", "[run]") {
+  using namespace Build;
+  using MyPython::Op;
+
+  int const depth = 100000;
+  auto one = std::make_shared<MyPython::Expression>(num(1));
+
+  SECTION("Left-nested chains") {
+    auto sum = one;
+    for (int i = 1; i < depth; ++i) {
+      MyPython::BinOp bin_op;
+      bin_op.left = sum;
+      bin_op.right = one;
+      sum = std::make_shared<MyPython::Expression>(bin_op);
+    }
+
+    MyPython::Assign assign;
+    assign.targets = {name("x")};
+    assign.value = sum;
+    MyPython::Module module;
+    module.body = {assign};
+
+    MyPython::Stack stack;
+    MyPython::run(module, stack);
+    REQUIRE(MyPython::cmp(*stack.globals.at("x"), depth) == 0);
+
+    module.body.clear();
+    assign.value.reset();
+    release(std::move(sum));
+  }
+
+  SECTION("Right-nested chains") {
+    auto sum = one;
+    for (int i = 1; i < depth; ++i) {
+      MyPython::BinOp bin_op;
+      bin_op.left = one;
+      bin_op.right = sum;
+      sum = std::make_shared<MyPython::Expression>(bin_op);
+    }
+
+    MyPython::Assign assign;
+    assign.targets = {name("x")};
+    assign.value = sum;
+    MyPython::Module module;
+    module.body = {assign};
+
+    MyPython::Stack stack;
+    MyPython::run(module, stack);
+    REQUIRE(MyPython::cmp(*stack.globals.at("x"), depth) == 0);
+
+    module.body.clear();
+    assign.value.reset();
+    release(std::move(sum));
+  }
+}
+
+TEST_CASE("Evaluates deep expressions inside functions on the VM", "[run]") {
+  using namespace Build;
+
+  int const depth = 100000;
+  auto one = std::make_shared<MyPython::Expression>(num(1));
+  bool left = true;
+  SECTION("Left-nested chains") { left = true; }
+  SECTION("Right-nested chains") { left = false; }
+
+  auto sum = one;
+  for (int i = 1; i < depth; ++i) {
+    MyPython::BinOp bin_op;
+    bin_op.left = left ? sum : one;
+    bin_op.right = left ? one : sum;
+    sum = std::make_shared<MyPython::Expression>(bin_op);
+  }
+
+  MyPython::Return ret;
+  ret.value = sum;
+  MyPython::Module module;
+  module.body = {def("f", {}, {ret}), assign("x", call("f", {}))};
+
+  MyPython::Stack stack;
+  MyPython::run(module, stack);
+  REQUIRE(MyPython::cmp(*stack.globals.at("x"), depth) == 0);
+
+  stack.globals.clear();
+  module.body.clear();
+  ret.value.reset();
+  release(std::move(sum));
+}
+
+TEST_CASE("Recurses without growing the native stack", "[run]") {
+  using namespace Build;
+  using MyPython::Op;
+
+  MyPython::Module module;
+  module.body = {
+      def("down", {"n"},
+          {if_stmt(name("n"),
+                   {ret(call("down", {bin_op(name("n"), Op::sub, num(1))}))}),
+           ret(name("n"))}),
+      assign("result", call("down", {num(100000)})),
+  };
+
+  MyPython::Stack stack;
+  MyPython::VMOptions options;
+
+  SECTION("Honours a raised recursion limit") {
+    options.recursion_limit = 200000;
+    MyPython::run(module, stack, options);
+    REQUIRE(MyPython::cmp(*stack.globals.at("result"), 0) == 0);
+  }
+
+  SECTION("Fails past the recursion limit") {
+    REQUIRE_THROWS([&] { MyPython::run(module, stack, options); }());
+  }
+}
+
+TEST_CASE("Captures enclosing variables in closures", "[run][eval_ast]") {
+  using namespace Build;
+  using MyPython::Op;
+
+  MyPython::Call call_add10;
+  call_add10.func = std::make_shared<MyPython::Expression>(name("add10"));
+  call_add10.args = {num(5)};
+
+  MyPython::Module module;
+  module.body = {
+      def("make_adder", {"n"},
+          {def("add", {"x"}, {ret(bin_op(name("x"), Op::add, name("n")))}),
+           ret(name("add"))}),
+      def("late", {},
+          {def("get", {}, {ret(name("x"))}), assign("x", num(1)),
+           assign("x", num(2)), ret(call("get", {}))}),
+      def("outer", {},
+          {def("rec", {"n"},
+               {if_stmt(name("n"), {ret(call("rec", {bin_op(name("n"), Op::sub,
+                                                             num(1))}))}),
+                ret(num(7))}),
+           ret(call("rec", {num(3)}))}),
+      def("l1", {"v"},
+          {def("l2", {},
+               {def("l3", {}, {ret(name("v"))}), ret(call("l3", {}))}),
+           ret(call("l2", {}))}),
+      assign("add10", call("make_adder", {num(10)})),
+      assign("a", call_add10),
+      assign("b", call("late", {})),
+      assign("c", call("outer", {})),
+      assign("d", call("l1", {num(9)})),
+  };
+
+  MyPython::Stack stack;
+
+  SECTION("On the tree-walker") { MyPython::eval_ast(module, stack); }
+  SECTION("On the VM") { MyPython::run(module, stack); }
+
+  REQUIRE(MyPython::cmp(*stack.globals.at("a"), 15) == 0);
+  REQUIRE(MyPython::cmp(*stack.globals.at("b"), 2) == 0);
+  REQUIRE(MyPython::cmp(*stack.globals.at("c"), 7) == 0);
+  REQUIRE(MyPython::cmp(*stack.globals.at("d"), 9) == 0);
+}
+
+TEST_CASE("Binds arguments into frame slots", "[compile][run]") {
+  using namespace Build;
+  using MyPython::Op;
+
+  MyPython::Call call_f;
+  call_f.func = std::make_shared<MyPython::Expression>(name("f"));
+  call_f.args = {num(1)};
+
+  MyPython::Module module;
+  module.body = {
+      def("inc", {"x"}, {ret(bin_op(name("x"), Op::add, num(1)))}),
+      def("pair", {"x", "y"}, {ret(name("x"))}),
+      def("apply", {"f"}, {ret(call_f)}),
+  };
+
+  SECTION("Compiles parameters to slot accesses") {
+    auto code = MyPython::compile(module);
+    auto const& inc = *code->functions.front();
+    REQUIRE(inc.nlocals == 1);
+    REQUIRE(inc.names.empty());
+    REQUIRE(inc.instrs.front().op == MyPython::OpCode::load_fast);
+  }
+
+  SECTION("Checks arity once per call site and callee") {
+    module.body.push_back(assign("a", call("apply", {name("inc")})));
+    module.body.push_back(assign("b", call("apply", {name("inc")})));
+    auto code = MyPython::compile(module);
+
+    MyPython::Stack stack;
+    MyPython::execute(*code, stack);
+    REQUIRE(MyPython::cmp(*stack.globals.at("b"), 2) == 0);
+
+    auto const& apply = *code->functions[2];
+    REQUIRE(!apply.call_sites.front().checked.expired());
+  }
+
+  SECTION("Rechecks arity when a call site sees a new callee") {
+    module.body.push_back(assign("a", call("apply", {name("inc")})));
+    module.body.push_back(assign("b", call("apply", {name("pair")})));
+
+    MyPython::Stack stack;
+    REQUIRE_THROWS([&] { MyPython::run(module, stack); }());
+    REQUIRE(MyPython::cmp(*stack.globals.at("a"), 2) == 0);
+  }
+}
+
+TEST_CASE("Suspends generators between yields", "[run][eval_ast]") {
+  using namespace Build;
+  using MyPython::Op;
+
+  MyPython::Module module;
+  module.body = {
+      def("count", {"n"},
+          {expr(yield(name("n"))),
+           assign("n", bin_op(name("n"), Op::add, num(1))),
+           expr(yield(name("n")))}),
+      def("first", {"g"}, {ret(call("next", {name("g")}))}),
+      assign("g", call("count", {num(5)})),
+      assign("a", call("next", {name("g")})),
+      assign("b", call("first", {name("g")})),
+  };
+
+  MyPython::Stack stack;
+
+  SECTION("On the tree-walker") { MyPython::eval_ast(module, stack); }
+  SECTION("On the VM") { MyPython::run(module, stack); }
+
+  REQUIRE(MyPython::cmp(*stack.globals.at("a"), 5) == 0);
+  REQUIRE(MyPython::cmp(*stack.globals.at("b"), 6) == 0);
+
+  MyPython::Module exhausted;
+  exhausted.body = {expr(call("next", {name("g")}))};
+  REQUIRE_THROWS([&] { MyPython::run(exhausted, stack); }());
+  REQUIRE_THROWS([&] { MyPython::eval_ast(exhausted, stack); }());
+}
+
+TEST_CASE("Runs while and for loops", "[run][eval_ast]") {
+  using namespace Build;
+  using MyPython::CmpOp;
+  using MyPython::Op;
+
+  auto add_to = [](std::string const& target, Expression value) {
+    return assign(target, bin_op(name(target), Op::add, value));
+  };
+
+  MyPython::Module module;
+  module.body = {
+      assign("n", num(0)),
+      while_stmt(compare(name("n"), {CmpOp::lt}, {num(5)}),
+                 {add_to("n", num(1))}, {assign("done", name("n"))}),
+      assign("total", num(0)),
+      for_stmt("i", call("range", {num(10), num(0), num(-3)}),
+               {add_to("total", name("i"))}),
+      assign("chars", str("")),
+      for_stmt("c", str("abc"),
+               {assign("chars", bin_op(name("c"), Op::add, name("chars")))}),
+      def("count", {"n"},
+          {while_stmt(name("n"), {expr(yield(name("n"))),
+                                  assign("n", bin_op(name("n"), Op::sub,
+                                                     num(1)))})}),
+      assign("yielded", num(0)),
+      for_stmt("k", call("count", {num(4)}), {add_to("yielded", name("k"))}),
+      def("last_getter", {},
+          {for_stmt("j", call("range", {num(3)}),
+                    {def("get", {}, {ret(name("j"))})}),
+           ret(call("get", {}))}),
+      assign("last", call("last_getter", {})),
+      assign("empty", str("untouched")),
+      for_stmt("e", call("range", {num(0)}), {assign("empty", name("e"))}),
+  };
+
+  MyPython::Stack stack;
+
+  SECTION("On the tree-walker") { MyPython::eval_ast(module, stack); }
+  SECTION("On the VM") { MyPython::run(module, stack); }
+
+  REQUIRE(MyPython::cmp(*stack.globals.at("done"), 5) == 0);
+  // 10 + 7 + 4 + 1
+  REQUIRE(MyPython::cmp(*stack.globals.at("total"), 22) == 0);
+  REQUIRE(MyPython::cmp(*stack.globals.at("i"), 1) == 0);
+  REQUIRE(MyPython::str(*stack.globals.at("chars")).string() == "cba");
+  REQUIRE(MyPython::cmp(*stack.globals.at("yielded"), 10) == 0);
+  REQUIRE(MyPython::cmp(*stack.globals.at("last"), 2) == 0);
+  REQUIRE(MyPython::str(*stack.globals.at("empty")).string() == "untouched");
+}
+
+TEST_CASE("Short-circuits bool operators", "[run][eval_ast]") {
+  using namespace Build;
+  using MyPython::BoolOperator;
+
+  auto and_op = [](Expression left, Expression right) {
+    return bool_op(left, BoolOperator::and_op, right);
+  };
+  auto or_op = [](Expression left, Expression right) {
+    return bool_op(left, BoolOperator::or_op, right);
+  };
+
+  // touch(x) records that it ran and returns x.
+  MyPython::Module module;
+  module.body = {
+      assign("calls", list({})),
+      def("touch", {"x"},
+          {expr(method(name("calls"), "append", {name("x")})),
+           ret(name("x"))}),
+      assign("a", and_op(num(0), call("touch", {num(1)}))),
+      assign("b", or_op(str("kept"), call("touch", {num(2)}))),
+      assign("c", and_op(str("x"), call("touch", {num(3)}))),
+      assign("d", or_op(and_op(num(0), call("touch", {num(4)})),
+                        or_op(str(""), call("touch", {num(5)})))),
+      assign("e", or_op(or_op(num(0), str("")), list({}))),
+      if_stmt(and_op(num(1), call("touch", {num(0)})),
+              {assign("taken", num(1))}, {assign("taken", num(0))}),
+  };
+
+  MyPython::Stack stack;
+
+  SECTION("On the tree-walker") { MyPython::eval_ast(module, stack); }
+  SECTION("On the VM") { MyPython::run(module, stack); }
+
+  REQUIRE(MyPython::cmp(*stack.globals.at("a"), 0) == 0);
+  REQUIRE(MyPython::str(*stack.globals.at("b")).string() == "kept");
+  REQUIRE(MyPython::cmp(*stack.globals.at("c"), 3) == 0);
+  REQUIRE(MyPython::cmp(*stack.globals.at("d"), 5) == 0);
+  REQUIRE(MyPython::str(*stack.globals.at("e")).string() == "[]");
+  REQUIRE(MyPython::cmp(*stack.globals.at("taken"), 0) == 0);
+  REQUIRE(MyPython::str(*stack.globals.at("calls")).string() == "[3, 5, 0]");
+}
+
+TEST_CASE("Chains comparisons lazily", "[run][eval_ast]") {
+  using namespace Build;
+  using MyPython::CmpOp;
+
+  // touch(x) records that it ran and returns x.
+  MyPython::Module module;
+  module.body = {
+      assign("calls", list({})),
+      def("touch", {"x"},
+          {expr(method(name("calls"), "append", {name("x")})),
+           ret(name("x"))}),
+      assign("inside", compare(num(1), {CmpOp::lt_eq, CmpOp::lt},
+                               {call("touch", {num(2)}), num(3)})),
+      assign("stops", compare(num(5), {CmpOp::lt, CmpOp::lt},
+                              {num(1), call("touch", {num(9)})})),
+      // (3 > 2) > 1 would be False.
+      assign("descends",
+             compare(num(3), {CmpOp::gt, CmpOp::gt}, {num(2), num(1)})),
+      assign("mixed", compare(num(1), {CmpOp::lt, CmpOp::eq_not, CmpOp::in},
+                              {num(2), num(3), list({num(3)})})),
+      if_stmt(compare(num(0), {CmpOp::lt_eq, CmpOp::lt},
+                      {num(5), call("touch", {num(4)})}),
+              {assign("taken", num(1))}, {assign("taken", num(0))}),
+  };
+
+  MyPython::Stack stack;
+
+  SECTION("On the tree-walker") { MyPython::eval_ast(module, stack); }
+  SECTION("On the VM") { MyPython::run(module, stack); }
+
+  REQUIRE(MyPython::str(*stack.globals.at("inside")).string() == "True");
+  REQUIRE(MyPython::str(*stack.globals.at("stops")).string() == "False");
+  REQUIRE(MyPython::str(*stack.globals.at("descends")).string() == "True");
+  REQUIRE(MyPython::str(*stack.globals.at("mixed")).string() == "True");
+  REQUIRE(MyPython::cmp(*stack.globals.at("taken"), 0) == 0);
+  REQUIRE(MyPython::str(*stack.globals.at("calls")).string() == "[2, 4]");
+}
+
+TEST_CASE("Updates augmented assignments in place", "[run][eval_ast]") {
+  using namespace Build;
+  using MyPython::Op;
+
+  auto aug = [](std::string const& target, Op op, Expression value) {
+    return aug_assign(name(target), op, value);
+  };
+
+  MyPython::Module module;
+  module.body = {
+      assign("n", num(0)),
+      for_stmt("i", call("range", {num(10)}), {aug("n", Op::add, name("i"))}),
+      assign("alias", name("n")),
+      aug("n", Op::add, num(1)),
+      assign("s", str("a")),
+      assign("t", name("s")),
+      aug("s", Op::add, str("b")),
+      // Lists are extended in place, so every name for one sees the change.
+      assign("l", list({num(1)})),
+      assign("m", name("l")),
+      aug("l", Op::add, list({num(2)})),
+      aug("l", Op::add, tuple({num(3)})),
+      aug_assign(subscript(name("l"), num(0)), Op::sub, num(10)),
+      assign("d", dict({str("k")}, {num(1)})),
+      aug_assign(subscript(name("d"), str("k")), Op::mul, num(6)),
+      assign("f", bin_op(num(1), Op::div, num(2))),
+      aug("f", Op::mul, name("f")),
+      assign("big", num(1 << 30)),
+      aug("big", Op::mul, name("big")),
+      aug("big", Op::mul, name("big")),
+      def("total", {"k"},
+          {assign("acc", num(0)),
+           for_stmt("j", call("range", {name("k")}),
+                    {aug("acc", Op::add, name("j"))}),
+           ret(name("acc"))}),
+      assign("summed", call("total", {num(5)})),
+      def("captured", {},
+          {assign("c", num(1)), def("get", {}, {ret(name("c"))}),
+           aug("c", Op::lshift, num(3)), ret(call("get", {}))}),
+      assign("shifted", call("captured", {})),
+  };
+
+  MyPython::Stack stack;
+
+  SECTION("On the tree-walker") { MyPython::eval_ast(module, stack); }
+  SECTION("On the VM") { MyPython::run(module, stack); }
+
+  auto text = [&](std::string const& name) {
+    return MyPython::str(*stack.globals.at(name)).string();
+  };
+  REQUIRE(text("alias") == "45");
+  REQUIRE(text("n") == "46");
+  REQUIRE(text("s") == "ab");
+  REQUIRE(text("t") == "a");
+  REQUIRE(text("m") == "[-9, 2, 3]");
+  REQUIRE(text("d") == "{'k': 6}");
+  REQUIRE(text("f") == "0.25");
+  REQUIRE(text("big") == "1329227995784915872903807060280344576");
+  REQUIRE(text("summed") == "10");
+  REQUIRE(text("shifted") == "8");
+
+  MyPython::Module unbound;
+  unbound.body = {aug("missing", Op::add, num(1))};
+  REQUIRE_THROWS([&] { MyPython::run(unbound, stack); }());
+  REQUIRE_THROWS([&] { MyPython::eval_ast(unbound, stack); }());
+}
+
+TEST_CASE("Dispatches if/elif chains through jump tables",
+          "[compile][run][eval_ast]") {
+  using namespace Build;
+  using MyPython::CmpOp;
+  using MyPython::Op;
+
+  // if x == keys[0]: return 0 / elif x == keys[1]: return 1 ... else tail.
+  auto chain = [](std::vector<Expression> keys, std::vector<Statement> tail) {
+    auto stmts = tail;
+    for (int i = keys.size() - 1; i >= 0; --i) {
+      stmts = {if_stmt(compare(name("x"), {CmpOp::eq}, {keys[i]}),
+                       {ret(num(i))}, stmts)};
+    }
+    return stmts;
+  };
+
+  auto dense = def(
+      "dense", {"x"},
+      chain({num(3), num(4), num(5), num(7), num(8)},
+            {if_stmt(compare(name("x"), {CmpOp::gt}, {num(10)}),
+                     {ret(num(10))}, {ret(num(-1))})}));
+  auto sparse = def("sparse", {"x"},
+                    chain({num(1), num(100), num(10000), num(-1000000)},
+                          {ret(num(-1))}));
+  auto verb = def("verb", {"x"},
+                  chain({str("get"), str("put"), str("post"), str("delete"),
+                         str("head"), str("options")},
+                        {ret(num(-1))}));
+
+  SECTION("Compiles one jump per chain") {
+    for (auto&& fun : {dense, sparse, verb}) {
+      auto code = MyPython::compile(mpark::get<MyPython::FunctionDef>(fun));
+      REQUIRE(code->jump_tables.size() == 1);
+      REQUIRE(code->instrs[1].op == MyPython::OpCode::jump_table);
+    }
+  }
+
+  auto three = bin_op(num(6), Op::div, num(2));
+  auto truth = compare(num(1), {CmpOp::eq}, {num(1)});
+  MyPython::Module module;
+  module.body = {
+      dense,
+      sparse,
+      verb,
+      assign("dense_results",
+             list({call("dense", {num(3)}), call("dense", {num(8)}),
+                   call("dense", {num(6)}), call("dense", {three}),
+                   call("dense", {num(11)})})),
+      assign("sparse_results",
+             list({call("sparse", {num(10000)}), call("sparse", {truth}),
+                   call("sparse", {num(-1000000)}),
+                   call("sparse", {num(2)})})),
+      assign("verb_results",
+             list({call("verb", {str("post")}), call("verb", {str("head")}),
+                   call("verb", {str("options")}),
+                   call("verb", {str("pu")})})),
+  };
+
+  MyPython::Stack stack;
+
+  SECTION("On the tree-walker") { MyPython::eval_ast(module, stack); }
+  SECTION("On the VM") { MyPython::run(module, stack); }
+
+  if (stack.globals.count("dense_results") != 0) {
+    auto text = [&](std::string const& name) {
+      return MyPython::str(*stack.globals.at(name)).string();
+    };
+    REQUIRE(text("dense_results") == "[0, 4, -1, 0, 10]");
+    REQUIRE(text("sparse_results") == "[2, 0, 3, -1]");
+    REQUIRE(text("verb_results") == "[2, 4, 5, -1]");
+
+    // Values that cannot be compared with the literals still throw.
+    for (auto&& bad : {call("dense", {str("3")}), call("sparse", {list({})}),
+                       call("verb", {num(0)})}) {
+      MyPython::Module mismatched;
+      mismatched.body = {dense, sparse, verb, expr(bad)};
+      REQUIRE_THROWS([&] { MyPython::run(mismatched, stack); }());
+      REQUIRE_THROWS([&] { MyPython::eval_ast(mismatched, stack); }());
+    }
+  }
+}
+
+TEST_CASE("Counts and unrolls loops over range()", "[compile][run]") {
+  using namespace Build;
+  using MyPython::Op;
+
+  // Each keeps the values it sees, so a counter updated in place while the
+  // list still refers to it would show up as repeats.
+  auto seen = [](std::string const& fun, Expression iter) {
+    MyPython::For loop;
+    loop.target = std::make_shared<Expression>(name("i"));
+    loop.iter = std::make_shared<Expression>(iter);
+    loop.body = {expr(method(name("values"), "append", {name("i")})),
+                 aug_assign(name("total"), Op::add, name("i"))};
+    loop.or_else = {expr(method(name("values"), "append", {str("done")}))};
+    return def(fun, {"n"},
+               {assign("values", list({})), assign("total", num(0)),
+                assign("i", str("unset")), loop,
+                ret(tuple({name("values"), name("total"), name("i")}))});
+  };
+  auto counted = seen("counted", call("range", {num(1), name("n"), num(2)}));
+  auto unrolled = seen("unrolled", call("range", {num(3)}));
+  auto empty = seen("empty", call("range", {num(5), num(5)}));
+
+  SECTION("Compiles the specialised forms") {
+    auto ops = [](Statement const& fun) {
+      auto code = MyPython::compile(mpark::get<MyPython::FunctionDef>(fun));
+      std::vector<MyPython::OpCode> ops;
+      for (auto&& instr : code->instrs) ops.push_back(instr.op);
+      return ops;
+    };
+    auto has = [](std::vector<MyPython::OpCode> const& ops,
+                  MyPython::OpCode op) {
+      return std::find(ops.begin(), ops.end(), op) != ops.end();
+    };
+    REQUIRE(has(ops(counted), MyPython::OpCode::next_count));
+    REQUIRE(!has(ops(counted), MyPython::OpCode::jump_if_not_range));
+    REQUIRE(has(ops(unrolled), MyPython::OpCode::jump_if_not_range));
+  }
+
+  MyPython::Module module;
+  module.body = {
+      counted,
+      unrolled,
+      empty,
+      assign("counted_result", call("counted", {num(8)})),
+      assign("unrolled_result", call("unrolled", {num(0)})),
+      assign("empty_result", call("empty", {num(0)})),
+  };
+  MyPython::Stack stack;
+  auto text = [&](std::string const& name) {
+    return MyPython::str(*stack.globals.at(name)).string();
+  };
+
+  SECTION("Runs them") {
+    MyPython::run(module, stack);
+    REQUIRE(text("counted_result") == "([1, 3, 5, 7, 'done'], 16, 7)");
+    REQUIRE(text("unrolled_result") == "([0, 1, 2, 'done'], 3, 2)");
+    REQUIRE(text("empty_result") == "(['done'], 0, 'unset')");
+  }
+
+  SECTION("Falls back when range is rebound") {
+    MyPython::Module rebound;
+    rebound.body = {
+        def("range", {"a"}, {ret(list({num(10), num(20)}))}),
+        unrolled,
+        assign("unrolled_result", call("unrolled", {num(0)})),
+        def("range", {"a", "b", "c"},
+            {expr(yield(num(30))), expr(yield(num(40)))}),
+        counted,
+        assign("counted_result", call("counted", {num(8)})),
+    };
+    MyPython::run(rebound, stack);
+    REQUIRE(text("unrolled_result") == "([10, 20, 'done'], 30, 20)");
+    REQUIRE(text("counted_result") == "([30, 40, 'done'], 70, 40)");
+  }
+}
+
+TEST_CASE("Computes range() lazily", "[eval_ast]") {
+  MyPython::PyRange r;
+  r.start = 10;
+  r.stop = -2;
+  r.step = -4;
+  REQUIRE(MyPython::length(r) == 3);
+  REQUIRE(MyPython::contains(r, 6));
+  REQUIRE(!MyPython::contains(r, 4));
+  REQUIRE(!MyPython::contains(r, -2));
+  REQUIRE(MyPython::str(r).string() == "range(10, -2, -4)");
+
+  r.start = std::numeric_limits<long>::min();
+  r.stop = std::numeric_limits<long>::max();
+  r.step = 1;
+  REQUIRE(MyPython::length(r) == std::numeric_limits<unsigned long>::max());
+  REQUIRE(MyPython::contains(r, std::numeric_limits<long>::max() - 1));
+
+  MyPython::Stack stack;
+  MyPython::Module module;
+  module.body = {Build::assign(
+      "r", Build::call("range", {Build::num(1), Build::num(2),
+                                 Build::num(0)}))};
+  REQUIRE_THROWS([&] { MyPython::run(module, stack); }());
+}
+
+TEST_CASE("Benchmarks counted loops", "[.][benchmark]") {
+  using namespace Build;
+  using MyPython::Op;
+
+  MyPython::Module module;
+  module.body = {
+      def("sum_to", {"n"},
+          {assign("total", num(0)),
+           for_stmt("i", call("range", {name("n")}),
+                    {assign("total", bin_op(name("total"), Op::add,
+                                            name("i")))}),
+           ret(name("total"))}),
+      assign("total", call("sum_to", {num(1000000)})),
+  };
+
+  BENCHMARK("for i in range(1000000) on the VM") {
+    MyPython::Stack stack;
+    MyPython::run(module, stack);
+    REQUIRE(MyPython::cmp(*stack.globals.at("total"), 499999500000) == 0);
+  }
+}
+
+TEST_CASE("Benchmarks augmented counters", "[.][benchmark]") {
+  using namespace Build;
+  using MyPython::Op;
+
+  MyPython::Module module;
+  module.body = {
+      def("sum_to", {"n"},
+          {assign("total", num(0)),
+           for_stmt("i", call("range", {name("n")}),
+                    {aug_assign(name("total"), Op::add, name("i"))}),
+           ret(name("total"))}),
+      assign("total", call("sum_to", {num(1000000)})),
+  };
+
+  BENCHMARK("total += i 1000000 times on the VM") {
+    MyPython::Stack stack;
+    MyPython::run(module, stack);
+    REQUIRE(MyPython::cmp(*stack.globals.at("total"), 499999500000) == 0);
+  }
+}
+
+TEST_CASE("Benchmarks elif dispatch", "[.][benchmark]") {
+  using namespace Build;
+  using MyPython::CmpOp;
+  using MyPython::Op;
+
+  // if op == 0: total += 0 / elif op == 1: total += 1 ... for 40 opcodes.
+  std::vector<Statement> dispatch = {aug_assign(name("total"), Op::sub,
+                                                num(1))};
+  for (int i = 39; i >= 0; --i) {
+    dispatch = {if_stmt(compare(name("op"), {CmpOp::eq}, {num(i)}),
+                        {aug_assign(name("total"), Op::add, num(i))},
+                        dispatch)};
+  }
+  std::vector<Statement> body = {
+      assign("op", bin_op(name("i"), Op::mod, num(40)))};
+  body.insert(body.end(), dispatch.begin(), dispatch.end());
+
+  MyPython::Module module;
+  module.body = {
+      def("run", {"n"},
+          {assign("total", num(0)),
+           for_stmt("i", call("range", {name("n")}), body),
+           ret(name("total"))}),
+      assign("total", call("run", {num(1000000)})),
+  };
+
+  BENCHMARK("40-way elif over 1000000 opcodes on the VM") {
+    MyPython::Stack stack;
+    MyPython::run(module, stack);
+    REQUIRE(MyPython::cmp(*stack.globals.at("total"), 19500000) == 0);
+  }
+}